@@ -0,0 +1,110 @@
+// dram_timing.hpp
+// All comments are in English.
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sf { namespace dram {
+
+// One contiguous byte range of a DRAM transaction.
+struct DramRange {
+  uint64_t addr = 0;
+  uint64_t bytes = 0;
+};
+
+// Counters of a timing model since its last Reset().
+struct DramTimingStats {
+  uint64_t transactions = 0;
+  uint64_t bursts = 0;
+  uint64_t row_hits = 0;    // bursts served from an open row
+  uint64_t row_misses = 0;  // bursts that had to open their row first
+};
+
+/**
+ * DramTiming
+ *
+ * Cycle model of DRAM transfers, kept apart from SimpleDRAM's storage. A
+ * transaction is the set of ranges one engine requests together (a weight
+ * load, an ISB batch, one output-spine store); Cycles() returns the cycles
+ * from its issue until its last byte moved. Models may keep state between
+ * transactions (open rows), so every Core works on its own Clone().
+ */
+class DramTiming {
+public:
+  virtual ~DramTiming() = default;
+
+  virtual uint64_t Cycles(const std::vector<DramRange>& ranges, bool write) = 0;
+  // Forget open rows and clear the counters.
+  virtual void Reset() { stats_ = {}; }
+  virtual std::unique_ptr<DramTiming> Clone() const = 0;
+
+  const DramTimingStats& stats() const { return stats_; }
+
+protected:
+  DramTimingStats stats_{};
+};
+
+// Fixed bandwidth plus a fixed overhead per transaction; addresses do not
+// matter. The default (160 bytes/cycle, no overhead) is the timing of every
+// load and store before the DRAM timing became pluggable.
+class FlatDramTiming final : public DramTiming {
+public:
+  explicit FlatDramTiming(double bytes_per_cycle = 160.0, uint32_t overhead_cycles = 0);
+
+  uint64_t Cycles(const std::vector<DramRange>& ranges, bool write) override;
+  std::unique_ptr<DramTiming> Clone() const override {
+    return std::make_unique<FlatDramTiming>(*this);
+  }
+
+private:
+  double   bpc_;
+  uint32_t overhead_;
+};
+
+struct BankedDramConfig {
+  uint32_t channels = 4;
+  uint32_t banks = 16;                       // per channel
+  uint32_t row_bytes = 2048;                 // row buffer of one bank
+  uint32_t burst_bytes = 64;                 // one column access
+  double   channel_bytes_per_cycle = 40.0;   // data bus of one channel
+  uint32_t row_hit_cycles = 14;              // column access latency
+  uint32_t row_miss_cycles = 28;             // precharge + activate before it
+  uint32_t transaction_overhead_cycles = 8;  // request setup
+};
+
+/**
+ * BankedDramTiming
+ *
+ * Channels x banks with one open row per bank. Addresses interleave across
+ * channels burst by burst; a channel's consecutive bursts fill one row of a
+ * bank, then move to the next bank. A burst to a bank whose open row differs
+ * waits row_miss_cycles after that bank's previous burst, while other banks
+ * keep the channel's data bus busy. A transaction takes its overhead, the
+ * data bus time of its slowest channel and one column access latency.
+ * Open rows persist across transactions, so a layout that keeps a load's
+ * ranges in few rows (or in the rows a previous load left open) pays fewer
+ * misses.
+ */
+class BankedDramTiming final : public DramTiming {
+public:
+  explicit BankedDramTiming(const BankedDramConfig& config = {});
+
+  uint64_t Cycles(const std::vector<DramRange>& ranges, bool write) override;
+  void Reset() override;
+  std::unique_ptr<DramTiming> Clone() const override {
+    return std::make_unique<BankedDramTiming>(*this);
+  }
+
+  const BankedDramConfig& config() const { return config_; }
+
+private:
+  BankedDramConfig config_;
+  uint64_t bursts_per_row_ = 1;
+  std::vector<int64_t>  open_row_;    // per (channel, bank); -1 = closed
+  // Scratch of one transaction (relative to its issue).
+  std::vector<uint64_t> bus_free_;    // per channel
+  std::vector<uint64_t> bank_free_;   // per (channel, bank)
+};
+
+}} // namespace sf::dram
@@ -0,0 +1,51 @@
+// mapped_file.hpp
+// All comments are in English.
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace sf { namespace dram {
+
+/**
+ * MappedFile
+ *
+ * RAII wrapper around a whole-file memory mapping (POSIX mmap).
+ *  - kReadOnly:    shared, read-only pages (backed by the page cache, so
+ *                  several processes mapping the same image share memory).
+ *  - kCopyOnWrite: private, writable pages; reads still come from the page
+ *                  cache, writes go to process-private copies and never
+ *                  reach the file.
+ *
+ * Move-only. Supported() reports whether this platform can map files; when
+ * it cannot, Open() throws std::runtime_error.
+ */
+class MappedFile {
+public:
+  enum class Mode { kReadOnly, kCopyOnWrite };
+
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  // Map the whole file at 'path'. An empty file yields an empty mapping.
+  static MappedFile Open(const std::string& path, Mode mode);
+  static bool Supported();
+
+  uint8_t*       data()       { return data_; }
+  const uint8_t* data() const { return data_; }
+  uint64_t size() const { return size_; }
+  bool writable() const { return mode_ == Mode::kCopyOnWrite; }
+
+private:
+  void Reset_();
+
+  uint8_t* data_ = nullptr;
+  uint64_t size_ = 0;
+  Mode     mode_ = Mode::kReadOnly;
+};
+
+}} // namespace sf::dram
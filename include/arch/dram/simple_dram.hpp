@@ -9,8 +9,69 @@
 #include <string>      // NEW
 #include <utility>     // NEW
 #include <iostream>    // NEW
+#include <optional>
+#include "arch/dram/mapped_file.hpp"
 namespace sf { namespace dram {
 
+/**
+ * IdTable<T>
+ *
+ * Lookup table keyed by a small integer id. Ids below kDenseLimit live in a
+ * vector indexed by id (spine ids are dense 0..H*W-1, tile and layer ids are
+ * dense too), so a lookup is one bounds check and one load. Larger ids fall
+ * back to an unordered_map so a stray sparse id cannot blow up the vector.
+ */
+template <typename T>
+class IdTable {
+public:
+  static constexpr uint32_t kDenseLimit = 1u << 20;
+
+  void Reserve(uint32_t max_id_plus_one) {
+    dense_.reserve(max_id_plus_one < kDenseLimit ? max_id_plus_one : kDenseLimit);
+  }
+
+  // Insert or overwrite the entry for 'id'.
+  T& Insert(uint32_t id, T value) {
+    if (id < kDenseLimit) {
+      if (id >= dense_.size()) dense_.resize(static_cast<size_t>(id) + 1);
+      auto& slot = dense_[id];
+      if (!slot) ++count_;
+      slot = std::move(value);
+      return *slot;
+    }
+    auto res = sparse_.insert_or_assign(id, std::move(value));
+    if (res.second) ++count_;
+    return res.first->second;
+  }
+
+  const T* Find(uint32_t id) const {
+    if (id < dense_.size()) return dense_[id] ? &*dense_[id] : nullptr;
+    if (sparse_.empty()) return nullptr;
+    auto it = sparse_.find(id);
+    return it == sparse_.end() ? nullptr : &it->second;
+  }
+  T* Find(uint32_t id) {
+    return const_cast<T*>(static_cast<const IdTable&>(*this).Find(id));
+  }
+
+  // Visit (id, entry) pairs: dense ids ascending, then sparse ids (unordered).
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    for (size_t i = 0; i < dense_.size(); ++i) {
+      if (dense_[i]) fn(static_cast<uint32_t>(i), *dense_[i]);
+    }
+    for (const auto& kv : sparse_) fn(kv.first, kv.second);
+  }
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+private:
+  std::vector<std::optional<T>>   dense_;
+  std::unordered_map<uint32_t, T> sparse_;
+  size_t count_ = 0;
+};
+
 struct SpineMeta {
   uint32_t id = 0;        // logical spine id
   uint64_t addr = 0;      // byte address in DRAM space
@@ -24,8 +85,8 @@ struct WeightTileMeta {
 };
 
 struct LayerMeta {
-  std::unordered_map<uint32_t, SpineMeta>        input_spines;
-  std::unordered_map<uint32_t, WeightTileMeta>   weight_tiles;
+  IdTable<SpineMeta>      input_spines;
+  IdTable<WeightTileMeta> weight_tiles;
   uint64_t output_write_ptr = 0;
   uint64_t output_region_begin = 0;
   uint64_t output_region_end   = 0;  // exclusive
@@ -34,6 +95,13 @@ struct LayerMeta {
 
 class SimpleDRAM {
 public:
+  // Backing store of the DRAM space.
+  //  - kCopy:   owned, zero-initialised buffer (image is read into it).
+  //  - kMapped: private copy-on-write mapping of the image file. Input and
+  //             weight reads hit the shared page cache; output stores only
+  //             dirty the pages they touch and never reach the file.
+  enum class Storage { kCopy, kMapped };
+
   explicit SimpleDRAM(uint64_t total_bytes)
     : mem_(total_bytes, 0) {}
 
@@ -47,47 +115,74 @@ public:
 
   // NEW: convenience factory that reads files and returns a populated DRAM.
   // This performs file I/O; put implementation in the .cpp.
-  static SimpleDRAM FromFiles(const std::string& bin_path, const std::string& json_path);
+  // kMapped falls back to kCopy where MappedFile is not supported.
+  static SimpleDRAM FromFiles(const std::string& bin_path, const std::string& json_path,
+                              Storage storage = Storage::kMapped);
+
+  // Image only (no layer metadata); used when metadata comes from elsewhere.
+  static SimpleDRAM FromImage(const std::string& bin_path, Storage storage = Storage::kMapped);
+
+  Storage storage() const { return mapped_.writable() ? Storage::kMapped : Storage::kCopy; }
+  uint64_t capacity() const { return mapped_.writable() ? mapped_.size() : mem_.size(); }
 
   // Install or replace per-layer metadata (built elsewhere).
   void SetLayerMeta(uint32_t L, LayerMeta meta) {
     if (meta.output_write_ptr < meta.output_region_begin ||
         meta.output_write_ptr > meta.output_region_end)
       throw std::invalid_argument("output write ptr out of region");
-    layers_[L] = std::move(meta);
+    layers_.Insert(L, std::move(meta));
+  }
+
+  const LayerMeta& layer_meta(uint32_t L) const {
+    const LayerMeta* meta = layers_.Find(L);
+    if (!meta) throw std::out_of_range("layer not found");
+    return *meta;
   }
 
   // Load an input spine by logical id: memcpy into dst.
   uint32_t LoadInputSpine(uint32_t L, uint32_t spine_id, void* dst, uint32_t max_bytes) const {
-    auto itL = layers_.find(L);
-    if (itL == layers_.end()) throw std::out_of_range("layer not found");
-    const auto& tbl = itL->second.input_spines;
-    auto it = tbl.find(spine_id);
-    if (it == tbl.end()) throw std::out_of_range("input spine not found");
-    const SpineMeta& m = it->second;
+    const SpineMeta* it = layer_meta(L).input_spines.Find(spine_id);
+    if (!it) throw std::out_of_range("input spine not found");
+    const SpineMeta& m = *it;
     const uint32_t n = (m.size <= max_bytes) ? m.size : max_bytes;
     safe_copy_out(dst, m.addr, n);
     return n;
   }
 
+  // Zero-copy variant of LoadInputSpine: points 'view' at the spine bytes
+  // inside DRAM memory instead of copying them. Returns the same byte count
+  // LoadInputSpine would copy. The view stays valid until the DRAM is
+  // destroyed; StoreOutputSpine never moves memory.
+  uint32_t ViewInputSpine(uint32_t L, uint32_t spine_id, const void*& view, uint32_t max_bytes) const {
+    const SpineMeta* it = layer_meta(L).input_spines.Find(spine_id);
+    if (!it) throw std::out_of_range("input spine not found");
+    const SpineMeta& m = *it;
+    const uint32_t n = (m.size <= max_bytes) ? m.size : max_bytes;
+    if (m.addr + n > capacity()) throw std::out_of_range("read out of range");
+    view = base() + m.addr;
+    return n;
+  }
+
   // Load a weight tile by tile id.
   uint32_t LoadWeightTile(uint32_t L, uint32_t tile_id, void* dst, uint32_t max_bytes) const {
-    auto itL = layers_.find(L);
-    if (itL == layers_.end()) throw std::out_of_range("layer not found");
-    const auto& tbl = itL->second.weight_tiles;
-    auto it = tbl.find(tile_id);
-    if (it == tbl.end()) throw std::out_of_range("weight tile not found");
-    const WeightTileMeta& m = it->second;
+    const WeightTileMeta* it = layer_meta(L).weight_tiles.Find(tile_id);
+    if (!it) throw std::out_of_range("weight tile not found");
+    const WeightTileMeta& m = *it;
     const uint32_t n = (m.size <= max_bytes) ? m.size : max_bytes;
     safe_copy_out(dst, m.addr, n);
     return n;
   }
 
+  // Concurrent layers may only call StoreOutputSpine if every layer appends
+  // into its own output region (each layer's LayerMeta is then touched by one
+  // thread only). Throws std::logic_error if two non-empty regions overlap.
+  void CheckOutputRegionsDisjoint() const;
+
   // Store one output spine (append-only).
   std::uint32_t StoreOutputSpine(uint32_t L, uint32_t spine_id, const void* src, uint32_t bytes) {
-    auto itL = layers_.find(L);
-    if (itL == layers_.end()) throw std::out_of_range("layer not found");
-    auto& meta = itL->second;
+    LayerMeta* found = layers_.Find(L);
+    if (!found) throw std::out_of_range("layer not found");
+    auto& meta = *found;
     if (meta.output_write_ptr + bytes > meta.output_region_end)
       throw std::overflow_error("output region full");
     safe_copy_in(meta.output_write_ptr, src, bytes);
@@ -98,18 +193,22 @@ public:
   }
 
 private:
+  const uint8_t* base() const { return mapped_.writable() ? mapped_.data() : mem_.data(); }
+  uint8_t*       base()       { return mapped_.writable() ? mapped_.data() : mem_.data(); }
+
   void safe_copy_out(void* dst, uint64_t addr, uint32_t n) const {
-    if (addr + n > mem_.size()) throw std::out_of_range("read out of range");
-    std::memcpy(dst, &mem_[static_cast<size_t>(addr)], n);
+    if (addr + n > capacity()) throw std::out_of_range("read out of range");
+    std::memcpy(dst, base() + addr, n);
   }
   void safe_copy_in(uint64_t addr, const void* src, uint32_t n) {
-    if (addr + n > mem_.size()) throw std::out_of_range("write out of range");
-    std::memcpy(&mem_[static_cast<size_t>(addr)], src, n);
+    if (addr + n > capacity()) throw std::out_of_range("write out of range");
+    std::memcpy(base() + addr, src, n);
   }
 
 private:
-  std::vector<uint8_t> mem_; // flat DRAM space
-  std::unordered_map<uint32_t, LayerMeta> layers_;
+  std::vector<uint8_t> mem_; // flat DRAM space (Storage::kCopy)
+  MappedFile mapped_;        // copy-on-write image mapping (Storage::kMapped)
+  IdTable<LayerMeta> layers_;  // indexed by L
 };
 
 }} // namespace sf::dram
@@ -4,11 +4,13 @@
 #include <array>
 #include <cstdint>
 #include <stdexcept>
-#include <unordered_set>   
 #include <unordered_map>   
 #include <optional>        
+#include <utility>
+#include <vector>
 #include <algorithm>       
 #include "common/constants.hpp"
+#include "arch/dram/dram_timing.hpp"
 #include "arch/dram/simple_dram.hpp"
 namespace sf { namespace dram {
   // Forward-declare SimpleDRAM to avoid forcing include path here.
@@ -17,6 +19,19 @@ namespace sf { namespace dram {
 
 namespace sf {
 
+// Tile replacement in FilterBuffer on a miss.
+//  - kClearAll: drop every resident tile and greedily load as many tiles as
+//    fit, starting at the requested one (original behavior).
+//  - kLru: load only the requested tile into a free slot, else evict the
+//    least recently used slot.
+//  - kBelady: like kLru but evict the tile whose next request is farthest
+//    away (oracle; needs SetRequestTrace).
+//  - kPingPong: the rows are split into two halves (SetPingPongSplit). The
+//    requested tile sits in one half while the next request (from the trace,
+//    else tile + 1) is prefetched into the other. Layers whose tiles do not
+//    fit in the smaller half behave as kClearAll.
+enum class WeightCachePolicy { kClearAll, kLru, kBelady, kPingPong };
+
 /**
  * FilterBuffer (Plan C, members-only ComputeRowId)
  *
@@ -24,22 +39,52 @@ namespace sf {
  * DRAM layout: [tile][input_channel][kh][kw][0..127]
  *
  * - Configure(...) sets layer-wise static parameters and DRAM ptr.
- * - Update(h_out, w_out) sets current output spatial coords.
- * - ComputeRowId(neuron_id) uses ONLY members (Cin, Win, Sh, Sw, Ph, Pw, Kh, Kw, h_out_cur, w_out_cur).
+ * - Update(h_out, w_out) sets current output spatial coords and rebuilds the
+ *   per-site row-id lookup: each kernel row r of the window covers one
+ *   contiguous neuron-id run, whose row ids are tabulated once per site.
+ * - ComputeRowId(neuron_id) is then a scan over <= K_h runs plus one table
+ *   lookup (no division, no logging on the per-spike path).
+ * - Weight tiles live in slots of RowsPerTile() rows; WeightCachePolicy
+ *   decides what a miss loads and evicts.
  */
 class FilterBuffer {
 public:
   using Row = std::array<std::int8_t, kNumPE>;
 
-  struct WeightTiming {
-    // Bandwidth in bytes per cycle for weight loads.
-    uint32_t bw_bytes_per_cycle = 160; // e.g., 128-bit bus => 16B/cycle
-    // Fixed per-transaction latency in cycles (e.g., DMA setup).
-    uint32_t fixed_latency = 0;
+  // Bookkeeping of which tiles currently live in rows_ (no weight data).
+  // Kept separate from the storage so layer drivers can replay the residency
+  // sequence cheaply and prime another FilterBuffer with the same state.
+  struct Residency {
+    // For each owned tile_id, the base row offset inside rows_
+    std::unordered_map<std::uint32_t, std::uint32_t> tile_base_row;
+    // The currently active tile
+    std::optional<std::uint32_t> active_tile_id;
+    // Slot view: resident tile per slot (-1 = free) and its replacement key
+    // (LRU: last access stamp; Belady: trace index of the next request).
+    std::vector<std::int64_t>  slot_tile;
+    std::vector<std::uint64_t> slot_key;
+    std::uint64_t clock = 0;      // kLru: access counter
+    std::uint64_t trace_pos = 0;  // kBelady/kPingPong: index of the next request in the trace
   };
+
   FilterBuffer() = default;
 
-  void SetWeightTiming(const WeightTiming& t) { wtiming_ = t; }
+  void SetCachePolicy(WeightCachePolicy policy) { policy_ = policy; }
+  WeightCachePolicy cache_policy() const { return policy_; }
+  // Rows of the first ping-pong half (the second gets the rest).
+  void SetPingPongSplit(std::uint32_t ping_rows);
+  // True if kPingPong is selected and this layer's tiles fit in either half.
+  bool PingPongActive() const {
+    const std::uint32_t half = std::min<std::uint32_t>(
+        pingpong_split_, static_cast<std::uint32_t>(kFilterRows) - pingpong_split_);
+    return policy_ == WeightCachePolicy::kPingPong && RowsPerTile() > 0 &&
+           static_cast<std::uint32_t>(RowsPerTile()) <= half;
+  }
+  // Full sequence of tile requests the layer will make (kBelady, and the
+  // kPingPong prefetch target); a request that deviates from it throws
+  // std::logic_error. Restarts the trace position (resident tiles stay), so
+  // each run of a layer sets its trace again.
+  void SetRequestTrace(std::vector<std::uint32_t> trace);
   // Layer-wise configuration (static).
   void Configure(int C_in, int W_in,
                  int Kh, int Kw,
@@ -47,12 +92,19 @@ public:
                  int Ph, int Pw,
                  sf::dram::SimpleDRAM* dram_ptr);
 
-  // Per-step update of the current output site (h_out, w_out).
+  // Per-step update of the current output site (h_out, w_out); rebuilds the
+  // site's row-id lookup (K_h * K_w * C_in entries).
   void Update(int h_out, int w_out);
 
-  // Compute row id using ONLY member configuration/state.
+  // Row id of neuron_id at the current output site.
   // Returns -1 if the tap maps outside the kernel window (padding/invalid).
-  int ComputeRowId(std::uint32_t neuron_id) const;
+  int ComputeRowId(std::uint32_t neuron_id) const {
+    for (const SiteRun& run : site_runs_) {
+      const std::uint32_t off = neuron_id - run.begin;  // wraps below 'begin'
+      if (off < run.len) return site_rows_[run.row_offset + off];
+    }
+    return -1;
+  }
 
   // Return a row by id (by value).
   Row GetRow(int row_id) const;
@@ -64,6 +116,37 @@ public:
                                    std::uint32_t tile_id,
                                    std::uint32_t layer_id);
 
+  // Breakdown of the latest LoadWeightFromDram: bytes dropped from resident
+  // tiles, bytes of the requested tile (0 on a hit) and bytes prefetched
+  // (kPingPong only) together with the prefetched tile.
+  std::uint32_t last_evicted_bytes() const { return last_evicted_bytes_; }
+  std::uint32_t last_demand_bytes() const { return last_demand_bytes_; }
+  std::uint32_t last_prefetch_bytes() const { return last_prefetch_bytes_; }
+  std::optional<std::uint32_t> last_prefetch_tile() const { return last_prefetch_tile_; }
+  // DRAM ranges of the demand and prefetched tiles of that load (for the
+  // DRAM timing model).
+  const std::vector<dram::DramRange>& last_demand_ranges() const { return last_demand_ranges_; }
+  const std::vector<dram::DramRange>& last_prefetch_ranges() const { return last_prefetch_ranges_; }
+
+  // Advance `r` exactly as LoadWeightFromDram would, without touching DRAM or rows_.
+  // Returns the bytes that the equivalent load would have pulled from DRAM.
+  std::uint32_t AdvanceResidency(Residency& r,
+                                 std::uint32_t total_tiles,
+                                 std::uint32_t tile_id) const {
+    return AdvanceResidency(r, total_tiles, tile_id, policy_);
+  }
+  // Same under another replacement policy (kBelady still uses this buffer's trace).
+  std::uint32_t AdvanceResidency(Residency& r,
+                                 std::uint32_t total_tiles,
+                                 std::uint32_t tile_id,
+                                 WeightCachePolicy policy) const;
+
+  // Current residency bookkeeping.
+  const Residency& residency() const { return residency_; }
+
+  // Install `r` and fetch the weights of every owned tile (no timing side effects).
+  void RestoreResidency(const Residency& r, std::uint32_t layer_id);
+
   // Optional helper.
   std::size_t NumRows() const { return kFilterRows; }
 
@@ -85,6 +168,16 @@ private:
   int h_out_cur_ = 0;
   int w_out_cur_ = 0;
 
+  // Row-id lookup of the current site: neuron ids [begin, begin + len) map
+  // to site_rows_[row_offset ..] (-1 where the row exceeds the storage).
+  struct SiteRun {
+    std::uint32_t begin = 0;
+    std::uint32_t len = 0;
+    std::uint32_t row_offset = 0;
+  };
+  std::vector<SiteRun> site_runs_;
+  std::vector<int> site_rows_;
+
   // DRAM interface (non-owning)
   sf::dram::SimpleDRAM* dram_ = nullptr;
 
@@ -92,21 +185,49 @@ private:
     return (a + b - 1) / b;
   }
 
-  WeightTiming wtiming_; // NEW: timing model for weights
-
   // --- Ownership & mapping of resident tiles in rows_ ---
-  // All tile_ids currently resident in rows_
-  std::unordered_set<std::uint32_t> owned_tile_id_;            // NEW
-  // For each owned tile_id, the base row offset inside rows_
-  std::unordered_map<std::uint32_t, std::uint32_t> tile_base_row_; // NEW
-  // The currently active tile
-  std::optional<std::uint32_t> active_tile_id_;                // NEW
+  Residency residency_;
+
+  // Tiles (tile_id, base_row) that a miss must fetch; empty on a hit.
+  using FetchList = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+  // Outcome of one tile request: tiles to fetch (demand first), resident
+  // tiles dropped, and the tile prefetched after the demand (kPingPong).
+  struct LoadPlan {
+    FetchList fetch;
+    std::uint32_t evicted = 0;
+    std::optional<std::uint32_t> prefetch;
+  };
+
+  // Shared by LoadWeightFromDram and AdvanceResidency: update `r` for a
+  // request of `tile_id` under `policy`.
+  LoadPlan PlanLoad_(Residency& r, std::uint32_t total_tiles, std::uint32_t tile_id,
+                     WeightCachePolicy policy) const;
+  // kPingPong part of PlanLoad_ (two slots at rows 0 and pingpong_split_).
+  void PlanPingPong_(Residency& r, std::uint32_t total_tiles, std::uint32_t tile_id,
+                     LoadPlan& plan) const;
+
+  WeightCachePolicy policy_ = WeightCachePolicy::kClearAll;
+  std::uint32_t pingpong_split_ = static_cast<std::uint32_t>(kFilterRows / 2);
+  std::vector<std::uint32_t> trace_;      // kBelady/kPingPong request sequence
+  std::vector<std::uint64_t> next_use_;   // index of the next request of trace_[i]
+  std::uint32_t last_evicted_bytes_ = 0;
+  std::uint32_t last_demand_bytes_ = 0;
+  std::uint32_t last_prefetch_bytes_ = 0;
+  std::optional<std::uint32_t> last_prefetch_tile_;
+  std::vector<dram::DramRange> last_demand_ranges_;
+  std::vector<dram::DramRange> last_prefetch_ranges_;
+
+  // Copy one tile from DRAM into rows_[base_row..]; returns bytes copied.
+  std::uint32_t FetchTile_(std::uint32_t layer_id, std::uint32_t tile_id, std::uint32_t base_row);
 
   // Helpers
   inline void ClearAllOwnership() {
-    owned_tile_id_.clear();
-    tile_base_row_.clear();
-    active_tile_id_.reset();
+    residency_ = Residency{};
+  }
+
+  inline std::uint32_t BytesPerTile() const {
+    return static_cast<std::uint32_t>(RowsPerTile()) * kNumPE * sizeof(std::int8_t);
   }
 
   inline int RowsPerTile() const {
@@ -115,9 +236,9 @@ private:
   }
 
   inline std::uint32_t ActiveBaseRow() const {
-    if (!active_tile_id_.has_value()) return 0;
-    auto it = tile_base_row_.find(active_tile_id_.value());
-    return (it == tile_base_row_.end()) ? 0u : it->second;
+    if (!residency_.active_tile_id.has_value()) return 0;
+    auto it = residency_.tile_base_row.find(residency_.active_tile_id.value());
+    return (it == residency_.tile_base_row.end()) ? 0u : it->second;
   }
 };
 
@@ -37,7 +37,18 @@ public:
   //   - Throws std::runtime_error if invariants are violated.
   bool run(Entry& out);
 
+  // Wide step: pop up to 'max' entries (in run() order) that share the
+  // timestamp of the first one. Returns the number popped (0 where run()
+  // returns false).
+  std::size_t RunSameTs(Entry* out, std::size_t max);
+
 private:
+  // Index and value of the smallest head (ts, then neuron_id); false if all
+  // FIFOs are empty.
+  bool FindBest_(std::size_t& best_idx, Entry& best_entry) const;
+  // Pop the head of FIFO 'idx' (which must be non-empty).
+  void PopFrom_(std::size_t idx);
+
   IntermediateFIFO* fifos_ = nullptr; // pointer to the FIFO array (non-owning)
   MinFinderBatch&   mfb_;             // reference to MinFinderBatch (non-owning)
 };
@@ -20,9 +20,14 @@ namespace sf {
 /**
  * InputSpineBuffer
  *
- * A fixed number of physical input-spine buffers (no shadow/active).
- * Each physical buffer holds an array of `Entry` (timestamp + neuron_id).
- * Data are block-loaded from DRAM by logical spine id, one batch at a time.
+ * A fixed number of physical input-spine buffers. Each physical buffer
+ * holds an array of `Entry` (timestamp + neuron_id). Data are block-loaded
+ * from DRAM by logical spine id, one batch at a time.
+ *
+ * Optionally every physical buffer has a shadow bank (SetShadowBank): a
+ * batch prefetched into it (PrefetchBatch) is swapped in by the next
+ * PreloadFirstBatch/run that asks for the same spine ids instead of being
+ * loaded again.
  *
  * Public API matches the specification you gave:
  *  1) PreloadFirstBatch(logical_spine_ids_first_batch, layer_id)
@@ -37,13 +42,31 @@ public:
   // Reset all buffers to empty (helper; not required by your spec but useful).
   void Reset();
 
+  // View mode: a physical buffer holds a (pointer, count) span into DRAM
+  // memory instead of a copy of the spine. Byte accounting is unchanged.
+  // Spines whose DRAM address is not aligned for Entry are still copied.
+  void SetViewMode(bool enable) { view_mode_ = enable; }
+  bool view_mode() const { return view_mode_; }
+
+  // Shadow/active double buffering. Disabling it drops a prefetched batch.
+  void SetShadowBank(bool enable);
+  bool shadow_bank() const { return shadow_enabled_; }
+
+  // Load a batch into the shadow bank while the active bank drains.
+  // Returns false (and loads nothing) if shadow banks are disabled.
+  bool PrefetchBatch(const std::vector<int>& logical_spine_ids, int layer_id);
+
+  // Drop the prefetched batch (if any).
+  void DiscardShadow() { shadow_valid_ = false; }
+
   // (A) Pre-load the first batch into the physical buffers.
   // Returns true if load happened, false if the input list is empty.
   bool PreloadFirstBatch(const std::vector<int>& logical_spine_ids_first_batch,
                          int layer_id);
 
   // (B) Run-time loader: if all buffers are empty and batches remain,
-  // load the current batch into physical buffers.
+  // load the current batch into physical buffers (or swap in the shadow bank
+  // if it holds this batch).
   // Returns true if a load happened this call; false otherwise.
   bool run(const std::vector<int>& logical_spine_ids_current_batch,
            int layer_id,
@@ -54,6 +77,12 @@ public:
   // Returns true if an entry was popped; false if all buffers are empty.
   bool PopSmallestTsEntry(Entry& out);
 
+  // (D) Bulk variant of (C): append every remaining entry to 'out' in the order
+  // repeated PopSmallestTsEntry() calls would return them (smallest head ts,
+  // lowest buffer index on ties) and leave all buffers empty.
+  // Returns the number of entries appended.
+  std::size_t MergeInto(std::vector<Entry>& out);
+
   // Utility: whether all physical buffers are empty.
   bool AllEmpty() const;
 
@@ -61,7 +90,8 @@ public:
   int NumPhysBuffers() const { return num_phys_; }
   int EntriesPerBuffer() const { return entries_per_buf_; }
 
-  // Bytes loaded by the most recent batch load (PreloadFirstBatch/run).
+  // Bytes loaded by the most recent batch load (PreloadFirstBatch/run); a
+  // swapped-in shadow batch reports the bytes of its prefetch.
   std::uint64_t LastLoadedBytes() const { return last_loaded_bytes_; }
 
 private:
@@ -70,10 +100,19 @@ private:
   uint64_t LoadBatchIntoBuffers_(const std::vector<int>& logical_spine_ids,
                              int layer_id);
 
+  // Make the shadow bank active if it holds exactly 'logical_spine_ids'.
+  bool TakeShadow_(const std::vector<int>& logical_spine_ids);
+
+  // Exchange the active and shadow bank state (O(1): vector swaps).
+  void SwapBanks_();
+
   static inline uint64_t CeilDivU64(uint64_t a, uint64_t b) {
     return (a + b - 1) / b;
   }
 
+  // Head-of-data pointer for buffer i (own storage or DRAM view).
+  const Entry* Data_(int i) const { return data_[static_cast<size_t>(i)]; }
+
   // Compute available entries in buffer i.
   int Available_(int i) const {
     return valid_count_[static_cast<size_t>(i)] - read_idx_[static_cast<size_t>(i)];
@@ -88,6 +127,11 @@ private:
   // Flat storage for physical buffers: buffers_[i][j] is the j-th entry in i-th buffer.
   std::vector<std::vector<Entry>> buffers_;
 
+  // Where buffer i's entries are read from: buffers_[i].data(), or the DRAM
+  // span in view mode.
+  std::vector<const Entry*> data_;
+  bool view_mode_ = false;
+
   // Per-buffer read pointer (in entries).
   std::vector<int> read_idx_;
 
@@ -103,6 +147,20 @@ private:
   // Accounting: total bytes copied by the last batch load.
   std::uint64_t last_loaded_bytes_ = 0;
 
+  // Shadow bank: same per-buffer state as the active bank above.
+  struct Bank {
+    std::vector<std::vector<Entry>> buffers;
+    std::vector<const Entry*> data;
+    std::vector<int> read_idx;
+    std::vector<int> valid_count;
+    std::vector<int> logical_id_loaded;
+    std::uint64_t loaded_bytes = 0;
+  };
+  Bank shadow_;
+  bool shadow_enabled_ = false;
+  bool shadow_valid_ = false;             // shadow_ holds shadow_ids_
+  std::vector<int> shadow_ids_;
+
 };
 
 } // namespace sf
@@ -0,0 +1,94 @@
+#pragma once
+// All comments are in English.
+
+#include <cstdint>
+#include <vector>
+
+#include "common/constants.hpp"  // kNumPhysISB
+
+namespace sf {
+
+/**
+ * IsbResidency
+ *
+ * Bookkeeping of which logical input spine each physical ISB buffer holds.
+ * Loading a batch only fetches the spines no buffer holds yet; they replace
+ * the least recently used buffers that the batch does not need. Adjacent
+ * output sites share most of their input window, so a sliding window only
+ * fetches its new column. Tags are content-addressed: the position of a
+ * spine in the batch (its merge priority) does not matter.
+ */
+class IsbResidency {
+public:
+  IsbResidency()
+    : tag_(static_cast<std::size_t>(kNumPhysISB), -1),
+      last_use_(static_cast<std::size_t>(kNumPhysISB), 0) {}
+
+  // Forget every resident spine.
+  void Clear() {
+    tag_.assign(tag_.size(), -1);
+    last_use_.assign(last_use_.size(), 0);
+    clock_ = 0;
+  }
+
+  // Account a batch load. bytes_of(spine_id) is the spine's load size.
+  // Returns the bytes fetched from DRAM; the bytes of resident spines are
+  // added to 'reused_bytes'.
+  template <typename BytesOf>
+  std::uint64_t Load(const std::vector<int>& ids, BytesOf&& bytes_of, std::uint64_t& reused_bytes) {
+    ++clock_;
+    std::vector<bool>& keep = keep_;
+    keep.assign(tag_.size(), false);
+    std::vector<int>& missing = missing_;
+    missing.clear();
+    for (const int id : ids) {
+      const int slot = Find_(id);
+      if (slot >= 0) {
+        keep[static_cast<std::size_t>(slot)] = true;
+        last_use_[static_cast<std::size_t>(slot)] = clock_;
+        reused_bytes += bytes_of(id);
+      } else {
+        missing.push_back(id);
+      }
+    }
+    std::uint64_t fetched = 0;
+    for (const int id : missing) {
+      const std::size_t slot = Victim_(keep);
+      tag_[slot] = id;
+      last_use_[slot] = clock_;
+      keep[slot] = true;
+      fetched += bytes_of(id);
+    }
+    return fetched;
+  }
+
+  // Spines the latest Load() fetched.
+  const std::vector<int>& last_fetched() const { return missing_; }
+
+private:
+  int Find_(int id) const {
+    for (std::size_t i = 0; i < tag_.size(); ++i) {
+      if (tag_[i] == id) return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  // Least recently used buffer not claimed by the current batch (a batch
+  // never holds more spines than there are buffers).
+  std::size_t Victim_(const std::vector<bool>& keep) const {
+    std::size_t best = tag_.size();
+    for (std::size_t i = 0; i < tag_.size(); ++i) {
+      if (keep[i]) continue;
+      if (best == tag_.size() || last_use_[i] < last_use_[best]) best = i;
+    }
+    return best;
+  }
+
+  std::vector<int> tag_;                 // spine id per buffer (-1 = empty)
+  std::vector<std::uint64_t> last_use_;  // Load() call that last used it
+  std::uint64_t clock_ = 0;
+  std::vector<bool> keep_;               // scratch
+  std::vector<int> missing_;             // spines fetched by the latest Load()
+};
+
+} // namespace sf
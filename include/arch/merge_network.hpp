@@ -0,0 +1,35 @@
+#pragma once
+// All comments are in English.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sf {
+
+// Hardware cost of a network that picks the 'width' smallest of 'inputs'
+// sorted heads per cycle: a binary tree whose nodes merge two sorted
+// width-lists and keep the lowest 'width' (a half-cleaner of 'width'
+// comparators, then a bitonic sort of the kept half). width == 1 is a plain
+// min-tree.
+struct MergeNetworkCost {
+  std::uint64_t comparators = 0;
+  std::uint64_t depth = 0;  // comparator stages (pipeline latency)
+};
+
+inline std::uint64_t CeilLog2(std::size_t n) {
+  std::uint64_t k = 0;
+  while ((std::size_t{1} << k) < n) ++k;
+  return k;
+}
+
+inline MergeNetworkCost SelectNetworkCost(std::size_t inputs, std::size_t width) {
+  MergeNetworkCost cost;
+  if (inputs < 2 || width == 0) return cost;
+  const std::uint64_t lw = CeilLog2(width);
+  const std::uint64_t per_node = width + (width / 2) * lw;
+  cost.comparators = static_cast<std::uint64_t>(inputs - 1) * per_node;
+  cost.depth = CeilLog2(inputs) * (1 + lw);
+  return cost;
+}
+
+} // namespace sf
@@ -40,6 +40,15 @@ public:
   // - Throws std::runtime_error on invalid wiring or out-of-range cursor.
   bool run(int current_batch_cursor, int batches_needed);
 
+  // Bookkeeping for one entry pushed into the FIFO of 'current_batch_cursor'
+  // (also used when the merged stream bypasses ISB/FIFO host logic).
+  void OnEntryPushed(int current_batch_cursor, int batches_needed) {
+    if (!last_batch_first_entry_pushed && current_batch_cursor == (batches_needed - 1)) {
+      last_batch_first_entry_pushed = true;
+    }
+    ++entry_count_total;
+  }
+
   // Query if global merger is allowed to work.
   // Returns true iff the first entry of the LAST batch has been pushed.
   bool CanGlobalMegerWork() const { return last_batch_first_entry_pushed; }
@@ -17,6 +17,8 @@ namespace sf {
  * - Single-entry merge: on each call to Sort(), pick the smallest-ts head
  *   across the 8 tile buffers, push it to OutputSpine, and return true.
  * - If all tile buffers are empty, return false.
+ * - SortCycle() is one cycle of a width-W sorter (SetWidth): up to W Sort()
+ *   steps, stopping early when the OutputSpine is full.
  * - Assumes each tile buffer is already monotonically non-decreasing in ts.
  */
 class OutputSorter {
@@ -26,9 +28,17 @@ public:
 
   bool Sort();
 
+  // Entries per cycle (1, 2, 4 or 8; std::invalid_argument otherwise).
+  void SetWidth(std::size_t width);
+  std::size_t width() const { return width_; }
+
+  // Returns the entries moved this cycle (0 if all tile buffers are empty).
+  std::size_t SortCycle();
+
 private:
   TiledOutputBuffer* tob_ = nullptr; // non-owning
   OutputSpine*       out_spine_ = nullptr; // non-owning
+  std::size_t        width_ = 1;
 };
 
 } // namespace sf
@@ -2,12 +2,14 @@
 // All comments are in English.
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <stdexcept>
 #include <vector>
-#include <optional>               // NEW
 
 #include "common/constants.hpp"
 #include "common/entry.hpp"
+#include "common/pe_mask.hpp"
 #include <cmath>                    // std::ldexp
 #include "arch/global_merger.hpp"   // uses GlobalMerger::run(Entry&)
 #include "arch/filter_buffer.hpp"   // FilterBuffer::ComputeRowId/GetRow
@@ -15,60 +17,73 @@
 
 namespace sf {
 
-// ===============================
-// PE (Processing Element) - local
-// ===============================
-class PE {
-public:
-  void RegisterOutputId(std::uint32_t outputId) { output_neuron_id_ = outputId; }
-  void SetThreshold(float th) { threshold_ = th; }
-
-  void Process(std::int8_t ts, float weight) {
-    vmem_ += weight;
-    if (vmem_ >= threshold_) {
-      vmem_ = 0.0f;
-      spiked_ = true;
-      last_ts_ = ts;
-    } else {
-      spiked_ = false;
-    }
-  }
-
-  bool spiked() const { return spiked_; }
-  std::uint32_t output_neuron_id() const { return output_neuron_id_; }
-  std::uint8_t last_ts() const { return last_ts_; }
-
-private:
-  float  vmem_ = 0.0f;
-  float  threshold_ = 1.0f;
-  std::uint32_t output_neuron_id_ = 0;
-  bool          spiked_ = false;
-  std::uint8_t  last_ts_ = 0;
-};
+// Membrane potential arithmetic of the PEs.
+//  - kFloat: float vmem += decoded weight, float threshold (reference model).
+//  - kInt16/kInt32: vmem counts raw Qm.n weight units in a saturating signed
+//    16/32-bit accumulator; the threshold is pre-quantized to the same format
+//    (ceil(threshold * 2^n), clamped to the accumulator range).
+enum class VmemMode { kFloat, kInt16, kInt32 };
 
+// Most input entries one PEArray step can integrate (SetInputWidth).
+inline constexpr std::size_t kMaxInputWidth = 8;
 
 // =======================
 // PEArray - top-level PE
 // =======================
+/**
+ * PEArray
+ *
+ * 128 integrate-and-fire PEs kept as structure-of-arrays state (vmem,
+ * threshold, out_id). One step adds the decoded weight row to every vmem,
+ * compares against the thresholds into a spike bitmask, resets the spiking
+ * lanes to 0 and lists them compactly. The step kernel uses AVX-512 or AVX2
+ * when the build enables them (see SFS_ENABLE_NATIVE_ARCH) and a scalar loop
+ * otherwise; all paths do a separate multiply and add, so results are
+ * bit-identical. SetVmemMode selects an exact integer accumulator instead.
+ *
+ * With an input width N > 1 (SetInputWidth) one step takes up to N entries
+ * of the same timestamp and runs N chained integrate/compare/reset stages,
+ * one per entry in GlobalMerger order, so vmem and spikes match N width-1
+ * steps exactly (a PE can fire in several stages of one step). Each stage
+ * that fires becomes one output stage of at most one entry per PE.
+ */
 class PEArray {
 public:
   explicit PEArray(GlobalMerger& gm) : gm_(gm) {
-    // No reserve needed; we use a fixed array of optionals.
+    threshold_.fill(1.0f);
     ResetOutputSlots();
   }
 
   void SetWeightParamsAndThres(float threshold, int w_bits, bool w_signed, int w_frac_bits, float w_scale) {
-    for (std::size_t pe_idx = 0; pe_idx < kNumPE; ++pe_idx) {
-      pe_array_[pe_idx].SetThreshold(threshold);
-    }
+    threshold_.fill(threshold);
     w_bits_ = w_bits;
     w_signed_ = w_signed;
     w_frac_bits_ = w_frac_bits;
     w_scale_ = w_scale;
+    UpdateDecodedParams_();
+  }
+
+  // Select float or saturating integer vmem. Integer modes need a Qm.n weight
+  // format (w_frac_bits >= 0 or a power-of-two w_scale); otherwise
+  // std::invalid_argument is thrown.
+  void SetVmemMode(VmemMode mode) {
+    vmem_mode_ = mode;
+    UpdateDecodedParams_();
+  }
+  VmemMode vmem_mode() const { return vmem_mode_; }
+
+  // Input entries per step: 1, 2, 4 or 8 (std::invalid_argument otherwise).
+  void SetInputWidth(std::size_t width) {
+    if (width != 1 && width != 2 && width != 4 && width != 8) {
+      throw std::invalid_argument("PEArray::SetInputWidth: width must be 1, 2, 4 or 8.");
+    }
+    input_width_ = width;
   }
+  std::size_t input_width() const { return input_width_; }
 
   // Initialize PEs before the outer while-loop of SpinalFlow.
   // output_id = (total_tiles * 128) * (h * W + w) + (tile_idx * 128) + pe_idx
+  // Each PE now owns a fresh output neuron, so its membrane potential restarts at 0.
   void InitPEsOutputNIDBeforeLoop(int total_tiles, int tile_idx, int h, int w, int W) {
     const int pos_index = h * W + w;
     const std::int64_t stride_pos = static_cast<std::int64_t>(total_tiles) * static_cast<std::int64_t>(kNumPE);
@@ -77,19 +92,15 @@ public:
 
     for (std::size_t pe_idx = 0; pe_idx < kNumPE; ++pe_idx) {
       const std::int64_t out_id64 = base_pos + tile_offset + static_cast<std::int64_t>(pe_idx);
-      const std::uint32_t out_id  = static_cast<std::uint32_t>(out_id64); // assume fits 32-bit
-      pe_array_[pe_idx].RegisterOutputId(out_id);
+      out_id_[pe_idx] = static_cast<std::uint32_t>(out_id64); // assume fits 32-bit
     }
-    ResetOutputSlots(); // was: out_spike_entries_.clear();
+    vmem_.fill(0.0f);
+    vmem_q_.fill(0);
+    ResetOutputSlots();
   }
 
   inline float DecodeWeightToFloat(std::int8_t wq) const noexcept {
-    if (w_frac_bits_ >= 0) {
-      // std::ldexp(1.0f, -n) == 2^-n
-      return static_cast<float>(wq) * std::ldexp(1.0f, -w_frac_bits_);
-    }
-    // Fallback to provided scale (should be 2^-n in your exporter)
-    return static_cast<float>(wq) * ((w_scale_ > 0.0f) ? w_scale_ : 1.0f);
+    return static_cast<float>(wq) * weight_scale_;
   }
 
   // Optional external feeding
@@ -97,12 +108,16 @@ public:
 
   // Fetch weight row using current gm_entry_.neuron_id and FilterBuffer state.
   void GetWeightRow(FilterBuffer& fb) {
-    const int row_id = fb.ComputeRowId(gm_entry_.neuron_id);
+    SelectWeightRow(fb, fb.ComputeRowId(gm_entry_.neuron_id));
+  }
+
+  // Fetch weight row for an already-computed row id (-1 for an invalid tap).
+  void SelectWeightRow(FilterBuffer& fb, int row_id) {
     if (row_id >= 0) {
       weight_row_ = fb.GetRow(row_id);
     } else {
       // If padded/invalid tap, zero the row to produce no spikes this step.
-      std::cout << "PEArray::GetWeightRow: Padding/invalid tap for neuron_id " << gm_entry_.neuron_id << ", zeroing weight row.\n";
+      ++invalid_taps_;
       weight_row_.fill(0);
     }
   }
@@ -110,31 +125,101 @@ public:
   // Main step: true if the array ran this cycle (GM provided an entry).
   bool run(FilterBuffer& fb);
 
-  // Access the spike outputs produced in the latest run-step.
-  // NEW: fixed array with one optional Entry per PE.
-  const std::array<std::optional<Entry>, kNumPE>& out_spike_entries() const { return out_spike_entries_; }
+  // Same step with the input entry and its weight row id supplied by the
+  // caller instead of GM/ComputeRowId (used when the merged input stream is
+  // computed up front).
+  void RunEntry(const Entry& in, int row_id, FilterBuffer& fb);
+
+  // Wide variant of RunEntry: 'n' (<= input_width()) entries sharing one ts.
+  void RunEntries(const Entry* in, const int* row_ids, std::size_t n, FilterBuffer& fb);
+
+  // Input entries (weight rows) consumed by the latest step.
+  std::size_t last_input_count() const { return last_input_count_; }
+
+  // Spike outputs of the latest run-step, one stage per integrate stage that
+  // fired, until a consumer takes them. out_spike_count/pe/entry describe the
+  // head stage: its spiking PEs in ascending order, at most one entry each.
+  bool has_output_spikes() const { return out_stage_head_ < out_stages_; }
+  std::size_t out_spike_count() const {
+    return has_output_spikes() ? out_stage_end_[out_stage_head_] - StageBegin_() : 0;
+  }
+  std::size_t out_spike_pe(std::size_t k) const { return out_pes_[StageBegin_() + k]; }
+  Entry out_spike_entry(std::size_t k) const {
+    Entry e{};
+    e.ts        = out_ts_;
+    e.neuron_id = out_id_[out_spike_pe(k)];
+    return e;
+  }
 
-  // Clear the spike outputs after a consumer copies them.
+  // Drop the head stage after a consumer copies it.
+  void PopOutputStage() { ++out_stage_head_; }
+  // Drop every stage.
   void ClearOutputSpikes();
 
+  // Input entries whose tap fell outside the kernel window (zero weight row).
+  std::uint64_t invalid_taps() const { return invalid_taps_; }
+  void ResetInvalidTaps() { invalid_taps_ = 0; }
+
 private:
-  // Helper to reset all output slots to empty.
+  // One integrate/compare/reset stage of gm_entry_ with weight_row_ over all
+  // PEs; its spikes are appended as an output stage.
+  void Integrate_();
+  // Append the spiking PEs of out_mask_ as an output stage (if any).
+  void CompactSpikes_();
+  std::size_t StageBegin_() const {
+    return (out_stage_head_ == 0) ? 0 : out_stage_end_[out_stage_head_ - 1];
+  }
+
+  // Derive weight_scale_ and (integer modes) threshold_q_/vmem bounds from the
+  // weight params, threshold and vmem mode.
+  void UpdateDecodedParams_();
+
+  // Helper to reset the spike outputs to empty.
   void ResetOutputSlots() {
-    for (auto& s : out_spike_entries_) s.reset();
+    out_count_ = 0;
+    out_stages_ = 0;
+    out_stage_head_ = 0;
   }
 
   GlobalMerger& gm_;                                          // reference to GM
   Entry gm_entry_{};                                          // input from GM
   std::array<std::int8_t, kNumPE> weight_row_{};              // weight row for current computation
-  std::array<PE, kNumPE> pe_array_{};                         // 128 PEs
-
-  // NEW: one optional Entry per PE for the current step.
-  std::array<std::optional<Entry>, kNumPE> out_spike_entries_{};
+  std::uint64_t invalid_taps_ = 0;                            // see invalid_taps()
+
+  // Wide input (input_width_ > 1).
+  std::size_t input_width_ = 1;
+  std::size_t last_input_count_ = 0;
+  std::array<Entry, kMaxInputWidth> group_{};                 // same-ts entries of a step
+  std::array<int, kMaxInputWidth> group_rows_{};              // their weight row ids
+
+  // Per-PE state (structure-of-arrays, one lane per PE).
+  alignas(64) std::array<float, kNumPE> vmem_{};
+  alignas(64) std::array<float, kNumPE> threshold_{};
+  std::array<std::uint32_t, kNumPE> out_id_{};
+
+  // Integer-mode state: vmem and threshold in raw weight units (int16 mode
+  // keeps the int32 lanes within the int16 range).
+  VmemMode vmem_mode_ = VmemMode::kFloat;
+  alignas(64) std::array<std::int32_t, kNumPE> vmem_q_{};
+  alignas(64) std::array<std::int32_t, kNumPE> threshold_q_{};
+  std::int32_t vmem_q_min_ = 0;
+  std::int32_t vmem_q_max_ = 0;
+
+  // Spikes of the current step; they all carry the input entries' ts.
+  // Stage s holds out_pes_[out_stage_end_[s - 1], out_stage_end_[s]).
+  PeMask out_mask_{};                                         // latest stage
+  std::array<std::uint16_t, kNumPE * kMaxInputWidth> out_pes_{};
+  std::array<std::size_t, kMaxInputWidth> out_stage_end_{};
+  std::size_t out_count_ = 0;
+  std::size_t out_stages_ = 0;
+  std::size_t out_stage_head_ = 0;
+  std::uint8_t out_ts_ = 0;
 
   int w_bits_ = 8;                                           // weight bit-width
   bool w_signed_ = true;                                     // weight signedness
   int w_frac_bits_ = 0;                                      // weight fractional bits (for fixed-point)
   float w_scale_ = 1.0f;                                     // weight scale (real multiplier)
+  float weight_scale_ = 1.0f;                                // decoded multiplier (2^-n or w_scale_)
 };
 
 } // namespace sf
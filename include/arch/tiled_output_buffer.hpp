@@ -3,11 +3,13 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
-#include <vector>
 
 #include "common/constants.hpp"
 #include "common/entry.hpp"
+#include "common/pe_mask.hpp"
+#include "common/ring_queue.hpp"
 
 namespace sf {
 class PEArray; // forward declaration; actual header is included in the .cpp
@@ -17,21 +19,31 @@ class PEArray; // forward declaration; actual header is included in the .cpp
  * TiledOutputBuffer
  *
  * - Aggregates output spikes from a PEArray into per-tile buffers.
- * - Adds per-PE local FIFOs (depth=4) to temporarily hold PE outputs.
- * - Input contract (new): PEArray::out_spike_entries() returns a fixed-size
- *   std::array<std::optional<Entry>, kNumPE>, one "slot" per PE per cycle.
+ * - Adds per-PE local FIFOs (depth=kLocalFifoDepth) to temporarily hold PE outputs.
+ * - Input contract: PEArray exposes the spikes of its latest step as stages
+ *   of a compact list (out_spike_count()/out_spike_pe(k)/out_spike_entry(k)
+ *   for the head stage, PopOutputStage()), at most one entry per PE each.
  * - "Tile" here means an output-spine partition (e.g., every 128 output channels).
  * - The caller passes tile_id on each run(...) to choose which tile buffer to append to.
  * - Stall policy (step 1): if any local FIFO is full, set stall_next_cycle_=true.
- *   We still emit one entry from the existing FIFO heads in the same run to avoid stalling the pipeline.
+ *   We still emit from the existing FIFO heads in the same run to avoid stalling the pipeline.
+ * - Emit width (SetEmitWidth): up to 1/2/4/8 entries per cycle, smallest ts
+ *   first (see SelectNetworkCost for the merge network this needs).
  */
 namespace sf {
 
 class TiledOutputBuffer {
+  static constexpr std::size_t kLocalFifoDepth = 2;
+
 public:
   explicit TiledOutputBuffer(PEArray& pe_array)
   : pe_array_(pe_array) {}
 
+  // Entries moved from the FIFO heads to the tile buffer per cycle (1, 2, 4
+  // or 8; std::invalid_argument otherwise).
+  void SetEmitWidth(std::size_t width);
+  std::size_t emit_width() const { return emit_width_; }
+
   // Returns true if anything happened (ingested from PEArray and/or emitted to a tile,
   // or stall flag updated).
   bool run(int tile_id);
@@ -41,22 +53,73 @@ public:
 
   void ClearAll();
 
+  // Everything ClearAll() resets: local FIFOs, tile buffers and flags. Lets a
+  // caller park one output site's partial result between tile passes.
+  struct State {
+    std::array<Entry, kNumPE * kLocalFifoDepth> fifo_slots{};
+    std::array<std::uint8_t, kNumPE> fifo_head{};
+    std::array<std::uint8_t, kNumPE> fifo_size{};
+    std::array<std::uint8_t, kNumPE> head_ts{};
+    PeMask nonempty_mask{};
+    PeMask full_mask{};
+    std::array<RingQueue<Entry>, kTilesPerSpine> tile_buffers;
+    bool stall_next_cycle = false;
+    std::size_t last_ingested_entries = 0;
+    std::size_t last_emitted_entries = 0;
+  };
+  // Move the current state out (the buffer is left cleared) / back in.
+  State TakeState();
+  void RestoreState(State&& s);
+
+  // Fast-forward helper: repeat the stalled form of run() (no ingest, emit the
+  // smallest heads) while any local FIFO is full. Returns the cycles advanced;
+  // afterwards the counters describe the last of those cycles.
+  std::size_t DrainWhileStalled(int tile_id);
+  // Entries emitted by the last DrainWhileStalled call.
+  std::size_t last_drain_emitted_entries() const { return last_drain_emitted_entries_; }
+
+  // True iff the next run() will assert stall (some local FIFO is full).
+  bool AnyLocalFifoFull() const { return AnyBit(full_mask_); }
+  // True iff every local FIFO is empty (all ingested spikes reached a tile).
+  bool LocalFifosEmpty() const { return !AnyBit(nonempty_mask_); }
+
   bool stall_next_cycle() const { return stall_next_cycle_; }
   std::size_t last_ingested_entries() const { return last_ingested_entries_; }
   std::size_t last_emitted_entries() const { return last_emitted_entries_; }
   static constexpr std::size_t LocalFifoDepth() { return kLocalFifoDepth; }
 
 private:
-  static constexpr std::size_t kLocalFifoDepth = 2;
+
+  // Move the smallest-ts FIFO head into tile buffer `tile_id`; false if all empty.
+  bool EmitOne_(int tile_id);
+  // One cycle of emission: up to emit_width_ EmitOne_ calls; returns the count.
+  std::size_t EmitCycle_(int tile_id);
+
+  // Per-PE local FIFO ring operations.
+  void FifoPush_(std::size_t pe, const Entry& e);
+  const Entry& FifoFront_(std::size_t pe) const {
+    return fifo_slots_[pe * kLocalFifoDepth + fifo_head_[pe]];
+  }
+  void FifoPop_(std::size_t pe);
 
   PEArray& pe_array_;
   bool stall_next_cycle_ = false;
+  std::size_t emit_width_ = 1;
+  std::size_t last_drain_emitted_entries_ = 0;
 
-  // Per-PE local FIFOs (front at index 0).
-  std::array<std::vector<Entry>, kNumPE> pe_fifos_{};
+  // Per-PE local FIFOs as fixed-capacity rings packed into one array:
+  // PE i owns fifo_slots_[i * kLocalFifoDepth, (i + 1) * kLocalFifoDepth).
+  std::array<Entry, kNumPE * kLocalFifoDepth> fifo_slots_{};
+  std::array<std::uint8_t, kNumPE> fifo_head_{};
+  std::array<std::uint8_t, kNumPE> fifo_size_{};
+  // Packed head timestamps (valid where nonempty_mask_ is set), so the
+  // minimum search touches one byte per active PE.
+  std::array<std::uint8_t, kNumPE> head_ts_{};
+  PeMask nonempty_mask_{};
+  PeMask full_mask_{};      // FIFOs holding kLocalFifoDepth entries
 
-  // kTilesPerSpine per-tile buffers (front at index 0).
-  std::array<std::vector<Entry>, kTilesPerSpine> tile_buffers_;
+  // kTilesPerSpine per-tile buffers.
+  std::array<RingQueue<Entry>, kTilesPerSpine> tile_buffers_;
 
   std::size_t last_ingested_entries_ = 0;
   std::size_t last_emitted_entries_ = 0;
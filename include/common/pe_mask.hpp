@@ -0,0 +1,36 @@
+#pragma once
+// All comments are in English.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "common/constants.hpp"
+
+namespace sf {
+
+// One bit per PE: bit (i % 64) of word (i / 64) is PE i.
+inline constexpr std::size_t kPeMaskWords = (kNumPE + 63) / 64;
+using PeMask = std::array<std::uint64_t, kPeMaskWords>;
+
+inline bool AnyBit(const PeMask& m) {
+  std::uint64_t any = 0;
+  for (std::uint64_t w : m) any |= w;
+  return any != 0;
+}
+
+// Index of the lowest set bit; 'w' must be non-zero.
+inline unsigned LowestSetBit(std::uint64_t w) {
+#if defined(_MSC_VER)
+  unsigned long idx = 0;
+  _BitScanForward64(&idx, w);
+  return static_cast<unsigned>(idx);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(w));
+#endif
+}
+
+} // namespace sf
@@ -0,0 +1,76 @@
+#pragma once
+// All comments are in English.
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace sf {
+
+/**
+ * RingQueue<T>
+ *
+ * Growable FIFO over one contiguous power-of-two ring. push_back/pop_front
+ * are O(1); the storage doubles (and is unrolled) when full and is kept
+ * across clear(), so a queue reused per site stops allocating after warm-up.
+ */
+template <typename T>
+class RingQueue {
+public:
+  RingQueue() = default;
+  RingQueue(const RingQueue&) = default;
+  RingQueue& operator=(const RingQueue&) = default;
+  // A moved-from queue is empty (not just storage-less).
+  RingQueue(RingQueue&& o) noexcept
+      : buf_(std::move(o.buf_)), head_(o.head_), size_(o.size_) {
+    o.head_ = 0;
+    o.size_ = 0;
+  }
+  RingQueue& operator=(RingQueue&& o) noexcept {
+    buf_.swap(o.buf_);
+    std::swap(head_, o.head_);
+    std::swap(size_, o.size_);
+    o.clear();
+    return *this;
+  }
+
+  bool empty() const { return size_ == 0; }
+  std::size_t size() const { return size_; }
+
+  const T& front() const { return buf_[head_]; }
+
+  void push_back(const T& v) {
+    if (size_ == buf_.size()) Grow_();
+    buf_[(head_ + size_) & (buf_.size() - 1)] = v;
+    ++size_;
+  }
+
+  void pop_front() {
+    if (size_ == 0) throw std::logic_error("RingQueue::pop_front: empty queue.");
+    head_ = (head_ + 1) & (buf_.size() - 1);
+    --size_;
+  }
+
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+private:
+  void Grow_() {
+    const std::size_t cap = buf_.empty() ? 16 : buf_.size() * 2;
+    std::vector<T> next(cap);
+    for (std::size_t i = 0; i < size_; ++i) {
+      next[i] = buf_[(head_ + i) & (buf_.size() - 1)];
+    }
+    buf_.swap(next);
+    head_ = 0;
+  }
+
+  std::vector<T> buf_;
+  std::size_t head_ = 0;
+  std::size_t size_ = 0;
+};
+
+} // namespace sf
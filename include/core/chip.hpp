@@ -0,0 +1,105 @@
+// All comments are in English.
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common/constants.hpp"
+#include "core/core.hpp"
+
+namespace sf {
+
+// Output-site partition of a Chip: fills 'core_of_site' (one entry per site
+// h_out * W_out + w_out) with a core index in [0, cores). site_work[s] is the
+// number of input entries site s merges per tile (its spike count).
+using SitePartitionPolicy = std::function<void(int cores, int H_out, int W_out,
+                                               const std::vector<std::uint64_t>& site_work,
+                                               std::vector<int>& core_of_site)>;
+
+// Site s on core s % cores (the default).
+SitePartitionPolicy RoundRobinSites();
+// Heaviest site first onto the least loaded core (by site_work).
+SitePartitionPolicy SpikeBalancedSites();
+// The output plane cut into a grid of near-square rectangles, one per core,
+// so neighbouring sites (which share input spines) stay on one core.
+SitePartitionPolicy SpatialBlockSites();
+
+struct ChipOptions {
+  int cores = 1;
+  // Bandwidth of the DRAM port every core shares.
+  double dram_bytes_per_cycle = kDefaultDramBytesPerCycle;
+  // Timing model of that port; empty = FlatDramTiming(dram_bytes_per_cycle).
+  std::shared_ptr<const dram::DramTiming> dram_timing;
+  SitePartitionPolicy partition{};  // empty = RoundRobinSites()
+};
+
+struct ChipCoreStats {
+  int sites = 0;
+  CoreCycleStats cycles{};
+  std::uint64_t busy_cycles = 0;        // load + compute + store of the core on its own
+  std::uint64_t dram_bytes = 0;
+  std::uint64_t dram_stall_cycles = 0;  // extra waiting for the shared port
+};
+
+struct ChipStats {
+  std::vector<ChipCoreStats> cores;
+  // Cycles until the last core finishes (busy + DRAM stall).
+  std::uint64_t makespan = 0;
+  // Cycles the shared DRAM port transferred data.
+  std::uint64_t dram_busy_cycles = 0;
+};
+
+/**
+ * Chip
+ *
+ * M Core instances that split the output sites of a site-major layer
+ * (SitePartitionPolicy). Every core owns its buffers and visits its sites in
+ * site order, so FilterBuffer residency and the rest of the cross-site Core
+ * state carry from one of its sites to the next.
+ *
+ * The cores share one DRAM port. Each core runs on its own timeline while
+ * recording its transfers (Core::SetDramTrace); the traces are then replayed
+ * first-come first-served on the shared port. A transfer that completes after
+ * its deadline stalls its core, which shifts that core's later transfers. A
+ * core's stall is the delay beyond a replay of its trace alone through its
+ * own link model (what the core model already waited for). The port serves
+ * one transfer at a time, timed by one DramTiming instance for all cores, so
+ * with a banked model the cores' transfers also close each other's rows.
+ */
+class Chip {
+public:
+  // Builds the core that runs 'sites' (ascending site ids).
+  using CoreFactory = std::function<std::unique_ptr<Core>(const std::vector<int>& sites)>;
+  // Runs one output site on 'core'.
+  using SiteRunner = std::function<void(Core& core, int site, int& drained_entries)>;
+
+  explicit Chip(const ChipOptions& options);
+
+  // Partitions the sites, runs every core (on up to host_threads threads) and
+  // arbitrates their DRAM traffic.
+  void Run(int H_out, int W_out, const std::vector<std::uint64_t>& site_work,
+           const CoreFactory& make_core, const SiteRunner& run_site, int host_threads);
+
+  const ChipStats& stats() const { return stats_; }
+  // Sums over the cores.
+  const CoreCycleStats& cycle_stats() const { return cycle_stats_; }
+  const CoreSramStats& sram_stats() const { return sram_stats_; }
+  int drained_entries() const { return drained_entries_; }
+
+  // First-come first-served replay of per-core DRAM traces on one port timed
+  // by a fresh copy of 'timing'. Returns the stall cycles of every core and
+  // adds the port busy cycles to 'port_busy_cycles' (if not null).
+  static std::vector<std::uint64_t> ReplayDram(const std::vector<std::vector<DramTransfer>>& traces,
+                                               const dram::DramTiming& timing,
+                                               std::uint64_t* port_busy_cycles);
+
+private:
+  ChipOptions options_{};
+  ChipStats stats_{};
+  CoreCycleStats cycle_stats_{};
+  CoreSramStats sram_stats_{};
+  int drained_entries_ = 0;
+};
+
+} // namespace sf
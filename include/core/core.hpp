@@ -1,8 +1,12 @@
 // All comments are in English.
 #pragma once
+#include <array>
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <unordered_map>
+#include <optional>
+#include <utility>
 #include <stdexcept>
 #include <iostream>
 
@@ -11,8 +15,11 @@
 #include "common/entry.hpp"
 
 // Subsystems
+#include "arch/dram/dram_timing.hpp"
 #include "arch/filter_buffer.hpp"
 #include "arch/input_spine_buffer.hpp"
+#include "arch/isb_residency.hpp"
+#include "arch/merge_network.hpp"
 #include "arch/intermediate_fifo.hpp"
 #include "arch/min_finder_batch.hpp"
 #include "arch/global_merger.hpp"
@@ -31,6 +38,25 @@ struct CoreCycleStats {
   std::uint64_t load_cycles = 0;
   std::uint64_t compute_cycles = 0;
   std::uint64_t store_cycles = 0;
+  // Tile requests that refilled the FilterBuffer from DRAM (misses) and that
+  // were served from resident weights (weight_reloads + weight_hits == tile
+  // requests), ping-pong prefetches of a later tile, the weight bytes all of
+  // them pulled, and bytes of resident tiles dropped by misses.
+  std::uint64_t weight_reloads = 0;
+  std::uint64_t weight_reload_bytes = 0;
+  std::uint64_t weight_hits = 0;
+  std::uint64_t weight_evicted_bytes = 0;
+  std::uint64_t weight_prefetches = 0;
+  // Cycles the TOB asserted stall (a local FIFO full) and cycles the output
+  // sorter ran (part of store_cycles unless overlap_store).
+  std::uint64_t tob_stall_cycles = 0;
+  std::uint64_t sort_cycles = 0;
+  // DRAM bursts served from an open row / that opened their row first
+  // (0 unless the DRAM timing model tracks rows).
+  std::uint64_t dram_row_hits = 0;
+  std::uint64_t dram_row_misses = 0;
+  // PE input entries whose tap fell outside the kernel window.
+  std::uint64_t invalid_taps = 0;
 };
 
 struct CoreSramStats {
@@ -48,12 +74,134 @@ struct CoreSramStats {
   std::uint64_t compute_load_bytes = 0;
   std::uint64_t compute_store_accesses = 0;
   std::uint64_t compute_store_bytes = 0;
+  // ISB spine bytes not fetched from DRAM because a buffer still held the
+  // spine (CoreOptions::isb_reuse).
+  std::uint64_t input_spine_dram_bytes_avoided = 0;
 
   std::uint64_t input_spine_capacity_bytes = 0;
   std::uint64_t filter_capacity_bytes = 0;
   std::uint64_t output_queue_capacity_bytes = 0;
+  // Extra ISB capacity of the shadow banks (0 unless CoreOptions::isb_shadow_bank).
+  std::uint64_t input_spine_shadow_capacity_bytes = 0;
+  // Extra output queue capacity of the second TOB bank (0 unless
+  // CoreOptions::overlap_store).
+  std::uint64_t output_queue_shadow_capacity_bytes = 0;
+  // Merge networks of the configured emit widths (SelectNetworkCost).
+  MergeNetworkCost tob_merge{};
+  MergeNetworkCost sorter_merge{};
 };
 
+// One DRAM transfer on the core timeline (Core::SetDramTrace): it can start
+// at 'issue' and the core stalls unless it has completed by 'ready'. Prefetches
+// and overlapped stores nobody waits on directly have no deadline. 'ranges'
+// is the DRAM transaction (a shared-port replay times it again).
+struct DramTransfer {
+  static constexpr std::uint64_t kNoDeadline = UINT64_MAX;
+  std::uint64_t issue = 0;
+  std::uint64_t ready = kNoDeadline;
+  std::uint64_t bytes = 0;
+  bool write = false;
+  std::vector<dram::DramRange> ranges;
+};
+
+// Per-core settings. fast_forward, validate_fast_forward, stream_merge and
+// zero_copy_isb are host-side simulation shortcuts that never change modeled
+// results; the rest are model choices.
+struct CoreOptions {
+  // Advance TOB-only stall stretches (PE/MFB gated off, a local FIFO full) in
+  // bulk instead of one StepOnce() per simulated cycle.
+  bool fast_forward = false;
+  // Run every stall stretch through StepOnce first, then rewind and
+  // fast-forward it; throw std::logic_error if the cycle count, compute and
+  // TOB stall cycles, IOShadow credit, output-queue SRAM counters or pipeline
+  // valids disagree.
+  bool validate_fast_forward = false;
+  // Merge each loaded ISB batch once (k-way merge into a contiguous stream)
+  // and drive the MFB/FIFO/GM timing from stream cursors instead of moving
+  // every entry through PopSmallestTsEntry/IntermediateFIFO/GlobalMerger.
+  // Later tiles of the same site replay the merged stream from a cache.
+  bool stream_merge = false;
+  // ISB buffers view the spines in DRAM memory instead of copying them
+  // (InputSpineBuffer::SetViewMode).
+  bool zero_copy_isb = false;
+  // PE membrane potential arithmetic (PEArray::SetVmemMode). Integer modes
+  // are a model choice: int16 saturation can change spike timing.
+  VmemMode vmem_mode = VmemMode::kFloat;
+  // FilterBuffer tile replacement (FilterBuffer::SetCachePolicy). kBelady
+  // needs the layer's request trace (SetWeightRequestTrace); kPingPong uses
+  // it to pick the prefetch target.
+  WeightCachePolicy weight_cache = WeightCachePolicy::kClearAll;
+  // Rows of the first ping-pong half (FilterBuffer::SetPingPongSplit).
+  std::uint32_t pingpong_split_rows = static_cast<std::uint32_t>(kFilterRows / 2);
+  // Give every ISB buffer a shadow bank: the next batch of the site (batch 0
+  // again after the last one, for the next tile) is prefetched while the
+  // current batch drains, on its own load timeline.
+  bool isb_shadow_bank = false;
+  // Keep input spines resident in the ISB across batches, tiles and sites
+  // (IsbResidency): a load only fetches spines no buffer holds.
+  bool isb_reuse = false;
+  // Sort and store a site's outputs while the next site computes instead of
+  // blocking on them (DrainAllTilesAndStore). The sorter handles one site at
+  // a time and loads wait for stores that hold the DRAM port; call
+  // Core::FlushOverlappedStores at the end of the layer. The TOB is double
+  // buffered (the next site fills one bank while the sorter reads the other),
+  // counted in CoreSramStats::output_queue_shadow_capacity_bytes.
+  bool overlap_store = false;
+  // Entries per cycle out of the TOB local FIFOs and through the output
+  // sorter (1, 2, 4 or 8).
+  std::size_t tob_emit_width = 1;
+  std::size_t sort_width = 1;
+  // Input entries per cycle through MFB, GM and the PE array (1, 2, 4 or 8):
+  // GM hands over up to this many same-ts entries, which the PEs integrate in
+  // chained stages (PEArray::SetInputWidth). Spikes do not depend on it.
+  std::size_t input_width = 1;
+  // DRAM timing backend, cloned into every core and fed the SpineMeta /
+  // WeightTileMeta ranges of each load and the store address of each output
+  // spine (Core::SetStoreSlot). Null = dram::FlatDramTiming at kDefaultDramBytesPerCycle. Layers
+  // using a backend run serially (open rows carry from site to site).
+  std::shared_ptr<const dram::DramTiming> dram_timing;
+};
+
+// Sum per-worker stats (capacities are per-core constants and are copied).
+inline void Accumulate(CoreCycleStats& dst, const CoreCycleStats& src) {
+  dst.load_cycles    += src.load_cycles;
+  dst.compute_cycles += src.compute_cycles;
+  dst.store_cycles   += src.store_cycles;
+  dst.weight_reloads      += src.weight_reloads;
+  dst.weight_reload_bytes += src.weight_reload_bytes;
+  dst.weight_hits         += src.weight_hits;
+  dst.weight_evicted_bytes += src.weight_evicted_bytes;
+  dst.weight_prefetches    += src.weight_prefetches;
+  dst.tob_stall_cycles     += src.tob_stall_cycles;
+  dst.sort_cycles          += src.sort_cycles;
+  dst.dram_row_hits        += src.dram_row_hits;
+  dst.dram_row_misses      += src.dram_row_misses;
+  dst.invalid_taps         += src.invalid_taps;
+}
+
+inline void Accumulate(CoreSramStats& dst, const CoreSramStats& src) {
+  auto add = [](CoreSramStats::Component& d, const CoreSramStats::Component& s) {
+    d.access_cycles += s.access_cycles;
+    d.accesses      += s.accesses;
+    d.bytes         += s.bytes;
+  };
+  add(dst.input_spine,  src.input_spine);
+  add(dst.filter,       src.filter);
+  add(dst.output_queue, src.output_queue);
+  dst.compute_load_accesses  += src.compute_load_accesses;
+  dst.compute_load_bytes     += src.compute_load_bytes;
+  dst.compute_store_accesses += src.compute_store_accesses;
+  dst.compute_store_bytes    += src.compute_store_bytes;
+  dst.input_spine_dram_bytes_avoided += src.input_spine_dram_bytes_avoided;
+  dst.input_spine_capacity_bytes  = src.input_spine_capacity_bytes;
+  dst.filter_capacity_bytes       = src.filter_capacity_bytes;
+  dst.output_queue_capacity_bytes = src.output_queue_capacity_bytes;
+  dst.input_spine_shadow_capacity_bytes = src.input_spine_shadow_capacity_bytes;
+  dst.output_queue_shadow_capacity_bytes = src.output_queue_shadow_capacity_bytes;
+  dst.tob_merge    = src.tob_merge;
+  dst.sorter_merge = src.sorter_merge;
+}
+
 class Core {
 public:
   // NOTE: This is a declaration, not a definition. Do NOT write "Core::Core" here.
@@ -74,6 +222,47 @@ public:
                 int batch_needed);
 
 
+  void SetOptions(const CoreOptions& options) {
+    options_ = options;
+    isb_.SetViewMode(options_.zero_copy_isb);
+    pe_array_.SetVmemMode(options_.vmem_mode);
+    fb_.SetCachePolicy(options_.weight_cache);
+    fb_.SetPingPongSplit(options_.pingpong_split_rows);
+    isb_.SetShadowBank(options_.isb_shadow_bank);
+    isb_prefetch_.reset();
+    sram_stats_.input_spine_shadow_capacity_bytes =
+        options_.isb_shadow_bank ? sram_stats_.input_spine_capacity_bytes : 0;
+    sram_stats_.output_queue_shadow_capacity_bytes =
+        options_.overlap_store ? sram_stats_.output_queue_capacity_bytes : 0;
+    pe_array_.SetInputWidth(options_.input_width);
+    tob_.SetEmitWidth(options_.tob_emit_width);
+    sorter_.SetWidth(options_.sort_width);
+    sram_stats_.tob_merge    = SelectNetworkCost(kNumPE, options_.tob_emit_width);
+    sram_stats_.sorter_merge = SelectNetworkCost(kTilesPerSpine, options_.sort_width);
+    if (options_.dram_timing) {
+      dram_timing_ = options_.dram_timing->Clone();
+    } else {
+      dram_timing_ = std::make_unique<dram::FlatDramTiming>(kDefaultDramBytesPerCycle);
+    }
+  }
+
+  // Every tile request of the layer in order (for WeightCachePolicy::kBelady).
+  void SetWeightRequestTrace(std::vector<std::uint32_t> trace) {
+    fb_.SetRequestTrace(std::move(trace));
+  }
+  const CoreOptions& options() const { return options_; }
+
+  // Record every DRAM transfer (weights, ISB batches, output stores) since
+  // ResetCycleStats() for a shared-port replay (Chip).
+  void SetDramTrace(bool enabled) { trace_dram_ = enabled; }
+  const std::vector<DramTransfer>& dram_trace() const { return dram_trace_; }
+  // Timing model of this core's DRAM link (CoreOptions::dram_timing).
+  const dram::DramTiming& dram_timing() const { return *dram_timing_; }
+  // Output stores use part 'slot' of the layer's output region split into
+  // 'slots' equal parts (or slot 'slot' of the scratch region past the DRAM
+  // image when that part cannot hold a store). Chip gives each core its own.
+  void SetStoreSlot(int slot, int slots);
+
   void SetBatchesTable(const std::unordered_map<std::uint64_t,
                         std::vector<std::vector<int>>>* batches_per_hw);
   void SetTotalTiles(int total_tiles);
@@ -96,7 +285,12 @@ public:
 
   // ---- Main step + drain ----
   bool StepOnce(int tile_id);
+  // Skip the TOB-only stall stretch that follows a StepOnce (if any) in one go.
+  // Returns the number of cycles advanced (0 if the next cycle is not stalled).
+  std::uint64_t FastForwardStall(int tile_id);
   void DrainAllTilesAndStore(int& drained_entries);
+  // Block until overlapped output stores finish (no-op without overlap_store).
+  void FlushOverlappedStores();
 
   // ---- Helpers ----
   bool FifosHaveData() const;
@@ -106,6 +300,28 @@ public:
   CoreCycleStats GetCycleStats() const;
   CoreSramStats GetSramStats() const;
 
+  // ---- Cross-site state (used by parallel site execution) ----
+  // FilterBuffer residency carries from one site to the next; a replica core
+  // is primed with the residency the serial run would have at its first site.
+  const FilterBuffer::Residency& filter_residency() const { return fb_.residency(); }
+  // Returns the bytes the equivalent weight load would pull from DRAM (under
+  // the configured replacement policy, or `policy`).
+  std::uint32_t AdvanceFilterResidency(FilterBuffer::Residency& r, int tile_id) const {
+    return AdvanceFilterResidency(r, tile_id, fb_.cache_policy());
+  }
+  std::uint32_t AdvanceFilterResidency(FilterBuffer::Residency& r, int tile_id,
+                                       WeightCachePolicy policy) const;
+  void RestoreFilterResidency(const FilterBuffer::Residency& r);
+  // Park / resume the current site's TOB contents (weight-stationary layers
+  // visit every site once per tile; call RestoreSiteOutput after
+  // PrepareForSpine and before PrepareForTile).
+  TiledOutputBuffer::State TakeSiteOutput() { return tob_.TakeState(); }
+  void RestoreSiteOutput(TiledOutputBuffer::State&& s) { tob_.RestoreState(std::move(s)); }
+  // Compute credit not yet applied to a load (carried into the next site).
+  std::uint64_t io_credit() const { return io_shadow_.Credit(); }
+  // Unshadowed cycles of the first weight load since ResetCycleStats().
+  std::uint64_t first_weight_load_cycles() const { return first_weight_load_cycles_; }
+
   // Accessors
   int  layer_id() const { return layer_id_; }
   int  H_out()    const { return H_out_; }
@@ -125,6 +341,55 @@ public:
 
 
 private:
+  // End-of-step bookkeeping shared by the per-entry and stream paths:
+  // next-cycle valids, SRAM counters and the synchronous tick.
+  void FinishStep_(bool fifo_has, bool isb_has, bool fifo_space);
+  // Stream path (CoreOptions::stream_merge).
+  // Loads batch 'b' of the current site (from the stream cache if present)
+  // and returns the ISB bytes to charge for it.
+  std::uint64_t LoadStream_(int b);
+  bool StreamPE_();
+  // One MFB cycle of the per-entry path (up to input_width entries).
+  bool RunMfb_();
+  bool StreamMFB_();
+
+  // Blocking cycles of a weight request served by the ping-pong load engine
+  // (FilterBuffer::PingPongActive): waits for an in-flight prefetch of this
+  // tile, or for the engine and then the demand load on a miss.
+  std::uint64_t PingPongWeightBlock_(int tile_id, std::uint64_t demand_cycles) const;
+
+  // Blocking cycles of loading batch 'b': the one-shot compute
+  // credit, or with isb_shadow_bank the remaining time of its prefetch.
+  // With isb_reuse only the non-resident spines are charged.
+  std::uint64_t IsbLoadBlock_(int b);
+  // isb_shadow_bank: start loading the batch that follows batch_cursor_.
+  void IssueIsbPrefetch_();
+  // DRAM range of one input spine of this layer (capped to a buffer).
+  dram::DramRange IsbSpineRange_(int spine_id) const;
+  std::uint64_t IsbSpineBytes_(int spine_id) const { return IsbSpineRange_(spine_id).bytes; }
+  // Cycles of loading input spines 'ids' as one DRAM transaction.
+  std::uint64_t IsbLoadCycles_(const std::vector<int>& ids);
+  // FastForwardStall without / with validate_fast_forward.
+  std::uint64_t FastForward_(int tile_id);
+  std::uint64_t ValidateFastForward_(int tile_id);
+  // Cycles of storing 'bytes' at this core's output-region cursor (the range
+  // is appended to store_ranges_).
+  std::uint64_t StoreCycles_(std::uint32_t bytes);
+  // Account loading 'ids' into the buffers tracked by 'tags'; returns the
+  // bytes fetched from DRAM.
+  std::uint64_t FetchIsbBatch_(IsbResidency& tags, const std::vector<int>& ids);
+
+  // Charge a blocking load (plus DRAM-port contention with overlapped stores).
+  void BlockOnLoad_(std::uint64_t block);
+  // overlap_store: time the sort/store of the drained chunks (bytes each).
+  // (bytes, DRAM cycles) per chunk.
+  void ScheduleOverlappedStore_(const std::vector<std::pair<std::uint32_t, std::uint64_t>>& chunks);
+
+  // Append the transaction 'ranges' to dram_trace_ (if enabled); 'ready' on
+  // the core timeline.
+  void TraceDram_(std::uint64_t issue, const std::vector<dram::DramRange>& ranges,
+                  std::uint64_t ready, bool write = false);
+
   void ResetIOTracking();
   void ConsumeBlockingCycles(std::uint64_t cycles);
   void ResetSramStats();
@@ -132,6 +397,7 @@ private:
 private:
   // ---- Wiring ----
   sf::dram::SimpleDRAM* dram_ = nullptr;
+  CoreOptions options_{};
 
   // ---- Per-layer params ----
   int layer_id_ = 0;
@@ -155,6 +421,30 @@ private:
   OutputSpine       out_spine_;
   OutputSorter      sorter_;
 
+  // ---- Ping-pong weight load engine (core timeline, see cycle_) ----
+  std::uint64_t weight_ready_cycle_ = 0;                   // in-flight prefetch completes
+  std::optional<std::uint32_t> pending_prefetch_tile_;     // tile of that prefetch
+
+  // ---- ISB shadow-bank prefetch (isb_shadow_bank) ----
+  struct IsbPrefetch {
+    std::vector<int> ids;        // logical spine ids of the prefetched batch
+    std::uint64_t issue_cycle;   // core cycle the load started
+    std::uint64_t bytes;         // DRAM bytes of the load
+    std::uint64_t cycles;        // DRAM cycles of the load
+  };
+  std::optional<IsbPrefetch> isb_prefetch_;
+  // Resident spines of the active and shadow banks (isb_reuse).
+  IsbResidency isb_tags_;
+  IsbResidency isb_shadow_tags_;
+
+  // ---- Overlapped output drain (overlap_store, core timeline) ----
+  std::uint64_t sorter_free_cycle_ = 0;
+  std::uint64_t store_port_free_cycle_ = 0;
+  std::array<std::uint64_t, 2> out_buffer_free_cycle_{};   // output-spine buffers
+  std::size_t next_out_buffer_ = 0;
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> store_busy_;  // [start, end)
+  std::vector<std::pair<std::uint32_t, std::uint64_t>> store_chunks_;  // scratch
+
   // ---- Per-(h,w) state ----
   int  h_out_cur_ = 0;
   int  w_out_cur_ = 0;
@@ -167,11 +457,30 @@ private:
   bool ran_tob_in_ = false;
   bool ran_pe_     = false;
   bool ran_mfb_    = false;
+  std::size_t mfb_moved_ = 0;  // entries the MFB moved in its latest cycle
 
   std::vector<std::vector<int>> current_inputspine_batches_;
   int batch_cursor_ = -1;
   int total_batches_needed_ = 0;
 
+  // Merged stream of one batch with the weight row id of every entry.
+  struct MergedBatch {
+    std::vector<Entry> entries;
+    std::vector<int>   row_ids;
+    std::uint64_t      loaded_bytes = 0;  // ISB bytes of the original load
+  };
+
+  // Stream path state (stream_merge only). The cache holds the merged batches
+  // of the site (h, w, batch list) it was built for. Entries of *stream_ in
+  // [stream_gm_pos_, stream_isb_pos_) model the target IntermediateFIFO.
+  std::vector<MergedBatch> stream_cache_;
+  std::vector<std::vector<int>> stream_cache_batches_;
+  int stream_cache_h_ = -1;
+  int stream_cache_w_ = -1;
+  const MergedBatch* stream_ = nullptr;
+  std::size_t stream_isb_pos_ = 0;
+  std::size_t stream_gm_pos_  = 0;
+
   // Per-layer tiling
   int total_tiles_ = 0;
 
@@ -180,7 +489,20 @@ private:
 
   CoreCycleStats cycle_stats_{};
   CoreSramStats sram_stats_{};
+  bool          first_weight_load_seen_   = false;
+  std::uint64_t first_weight_load_cycles_ = 0;
   IOShadow io_shadow_{kDefaultDramBytesPerCycle};
+  bool trace_dram_ = false;
+  std::vector<DramTransfer> dram_trace_;
+
+  // ---- DRAM timing (CoreOptions::dram_timing) ----
+  std::unique_ptr<dram::DramTiming> dram_timing_ =
+      std::make_unique<dram::FlatDramTiming>(kDefaultDramBytesPerCycle);
+  std::vector<dram::DramRange> dram_ranges_;   // scratch
+  std::vector<dram::DramRange> store_ranges_;  // stores of the current drain
+  std::uint64_t store_addr_ = 0;               // next output store address
+  int store_slot_  = 0;                        // SetStoreSlot
+  int store_slots_ = 1;
 };
 
 } // namespace sf
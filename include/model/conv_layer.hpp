@@ -4,15 +4,36 @@
 #include <cstdint>
 #include <stdexcept>
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <unordered_map>
 
 #include "common/constants.hpp"
 #include "arch/dram/simple_dram.hpp"
+#include "core/chip.hpp"
 #include "core/core.hpp"
 
 namespace sf {
 
+// Loop order of ConvLayer::run_layer.
+//  - kSiteMajor: sites outer, tiles inner (each site is finished and drained
+//    before the next one starts).
+//  - kWeightStationary: tiles outer, sites inner. Each tile's weights are
+//    loaded once per pass; every site's TOB contents are parked between passes
+//    and the site is drained after the last tile.
+enum class ConvDataflow { kSiteMajor, kWeightStationary };
+
+// Site-major tile traversal: fills 'order' with the tiles to visit at output
+// site 'site' (h_out * W_out + w_out); must be a permutation of
+// 0..total_tiles-1.
+using TileOrderPolicy = std::function<void(int site, int total_tiles, std::vector<int>& order)>;
+
+// 0..N-1 at every site (the default).
+TileOrderPolicy AscendingTileOrder();
+// 0..N-1 on even sites, N-1..0 on odd sites, so a site starts with the tile
+// the previous site finished on.
+TileOrderPolicy SerpentineTileOrder();
+
 class ConvLayer {
 public:
   ConvLayer() = default;
@@ -33,10 +54,40 @@ public:
   // Builds batches for a single (h_out, w_out).
   std::vector<std::vector<int>> generate_batches(int h_out, int w_out) const;
 
+  // Number of worker threads used by run_layer(). 1 (default) runs every
+  // output site on core_; N > 1 shards contiguous site ranges over N Core
+  // replicas and merges their stats in site order (bit-identical to serial).
+  void SetNumThreads(int num_threads);
+  int  num_threads() const { return num_threads_; }
+
+  // Host-side Core shortcuts (see CoreOptions); applied to every Core this layer runs.
+  void SetCoreOptions(const CoreOptions& options);
+
+  // Loop order (see ConvDataflow). Weight-stationary layers run serially:
+  // every tile pass carries state through all sites (so do layers using
+  // WeightCachePolicy::kPingPong, CoreOptions::isb_reuse,
+  // CoreOptions::overlap_store or CoreOptions::dram_timing).
+  void SetDataflow(ConvDataflow dataflow) { dataflow_ = dataflow; }
+  ConvDataflow dataflow() const { return dataflow_; }
+
+  // Per-site tile order of the site-major dataflow (empty = ascending).
+  void SetTileOrder(TileOrderPolicy policy) { tile_order_ = std::move(policy); }
+
+  // Run the layer on a multi-core Chip (options.cores > 1; site-major only).
+  // num_threads() then bounds the host threads running its cores.
+  void SetChip(const ChipOptions& options) { chip_options_ = options; }
+
   void run_layer();
   const CoreCycleStats& cycle_stats() const { return last_cycle_stats_; }
   const CoreSramStats& sram_stats() const { return last_sram_stats_; }
   int drained_entries_total() const { return drained_entries_total_; }
+  // Weight bytes the last run_layer() avoided compared with site-major
+  // ascending order under WeightCachePolicy::kClearAll (negative if it
+  // loaded more).
+  std::int64_t weight_bytes_saved() const { return weight_bytes_saved_; }
+  // Per-core cycles and makespan of the last run_layer() (no cores unless it
+  // ran on a Chip).
+  const ChipStats& chip_stats() const { return last_chip_stats_; }
 private:
   static int DeriveOutDim(int in, int pad, int kernel, int stride) {
     const int numer = in + 2 * pad - kernel;
@@ -52,6 +103,34 @@ private:
            static_cast<std::uint32_t>(w);
   }
 
+  // Build a Core wired to this layer's params and batches table.
+  std::unique_ptr<Core> MakeCore_() const;
+
+  // Tiles to visit at `site`, per tile_order_ (validated).
+  void TileOrderFor_(int site, std::vector<int>& order) const;
+
+  // Every weight tile request of run_layer() in order, per dataflow_ and
+  // tile_order_ (the FilterBuffer Belady trace).
+  std::vector<std::uint32_t> WeightRequestTrace_() const;
+  // The requests of the site-major sites `sites` only (one Chip core).
+  std::vector<std::uint32_t> SiteRequestTrace_(const std::vector<int>& sites) const;
+
+  // Input entries a site merges per tile (SitePartitionPolicy site_work).
+  std::vector<std::uint64_t> SiteWork_() const;
+
+  // Prepare, compute `tiles` in order and drain one output site on `core`.
+  static void RunSite_(Core& core, int h, int w, const std::vector<int>& tiles,
+                       int& drained_entries);
+
+  // Shard sites over num_threads_ Core replicas (see SetNumThreads).
+  void RunLayerParallel_();
+
+  // Partition sites over chip_options_.cores Core instances (see Chip).
+  void RunChip_();
+
+  // Tiles outer, sites inner on `core` (ConvDataflow::kWeightStationary).
+  void RunWeightStationary_(Core& core);
+
 private:
   // --- Static layer parameters (immutable after ConfigureLayer) ---
   int layer_id_ = 0;
@@ -81,9 +160,16 @@ private:
   // --- Runtime handles ---
   sf::dram::SimpleDRAM* dram_ = nullptr;     // non-owning
   std::unique_ptr<Core> core_;               // Core owns its own FB/ISB/etc.
+  int num_threads_ = 1;                      // site-parallel workers
+  ConvDataflow dataflow_ = ConvDataflow::kSiteMajor;
+  TileOrderPolicy tile_order_;
+  CoreOptions core_options_{};
+  ChipOptions chip_options_{};
+  ChipStats last_chip_stats_{};
   CoreCycleStats last_cycle_stats_{};
   CoreSramStats last_sram_stats_{};
   int drained_entries_total_ = 0;
+  std::int64_t weight_bytes_saved_ = 0;
 };
 
 } // namespace sf
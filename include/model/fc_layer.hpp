@@ -39,6 +39,9 @@ public:
   // FC uses all H_in*W_in as a single receptive field; h_out/w_out are ignored.
   std::vector<std::vector<int>> generate_batches(int h_out, int w_out) const;
 
+  // Host-side Core shortcuts (see CoreOptions); applied to every Core this layer runs.
+  void SetCoreOptions(const CoreOptions& options);
+
   void run_layer();
   const CoreCycleStats& cycle_stats() const { return last_cycle_stats_; }
   const CoreSramStats& sram_stats() const { return last_sram_stats_; }
@@ -83,6 +86,7 @@ private:
   // --- Runtime handles ---
   sf::dram::SimpleDRAM* dram_{nullptr}; // non-owning
   std::unique_ptr<Core> core_;          // Core owns its engines as value members
+  CoreOptions core_options_{};
   CoreCycleStats last_cycle_stats_{};
   CoreSramStats last_sram_stats_{};
   int drained_entries_total_{0};
@@ -0,0 +1,85 @@
+// All comments are in English.
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "arch/dram/simple_dram.hpp"
+#include "runner/simulation.hpp"
+
+namespace sf {
+
+/**
+ * Binary metadata index (".sfmi")
+ *
+ * Compact replacement for dram_meta.json at startup. One file holds, for
+ * every layer, the LayerSpec parameters and the DRAM tables as flat
+ * (addr, size) arrays indexed directly by spine/tile id. Layout (host byte
+ * order, recorded in the header):
+ *
+ *   MetaIndexHeader
+ *   MetaIndexLayer[num_layers]
+ *   string blob (layer names, 8-byte padded)
+ *   per layer: MetaIndexSlot[num_input_spines], MetaIndexSlot[num_weight_tiles]
+ *
+ * Slot arrays cover ids 0..max_id; ids absent from the JSON have present = 0.
+ * WriteMetaIndex rejects ids at or above IdTable::kDenseLimit
+ * (std::invalid_argument).
+ * Bump kMetaIndexVersion whenever a record layout changes.
+ */
+inline constexpr char          kMetaIndexMagic[8] = {'S', 'F', 'M', 'I', 'D', 'X', '\0', '\0'};
+inline constexpr std::uint32_t kMetaIndexVersion  = 1;
+inline constexpr std::uint32_t kMetaIndexByteOrder = 0x01020304u;
+
+struct MetaIndexHeader {
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t num_layers;
+  std::uint32_t reserved;
+  std::uint64_t layers_offset;
+  std::uint64_t strings_offset;
+  std::uint64_t strings_size;
+  std::uint64_t file_size;
+};
+
+struct MetaIndexLayer {
+  std::int32_t L, kind;
+  std::int32_t Cin_in, H_in, W_in;
+  std::int32_t Cin_w, Cout, Kh, Kw, Sh, Sw, Ph, Pw, Dh, Dw;
+  std::int32_t Cout_out, H_out, W_out;
+  float        threshold;
+  std::int32_t w_bits, w_signed, w_frac_bits;
+  float        w_scale, w_float_min, w_float_max;
+  std::uint32_t flags;                 // kMetaIndexHasQFormat | kMetaIndexHasScale
+  std::uint32_t name_offset, name_size;
+  std::uint32_t num_input_spines, num_weight_tiles;
+  std::uint64_t input_spines_offset, weight_tiles_offset;
+  std::uint64_t output_region_begin, output_region_end, output_write_ptr;
+};
+
+struct MetaIndexSlot {
+  std::uint64_t addr;
+  std::uint32_t size;
+  std::uint32_t present;
+};
+
+inline constexpr std::uint32_t kMetaIndexHasQFormat = 1u << 0;
+inline constexpr std::uint32_t kMetaIndexHasScale   = 1u << 1;
+
+static_assert(sizeof(MetaIndexHeader) == 56, "MetaIndexHeader layout changed; bump kMetaIndexVersion.");
+static_assert(sizeof(MetaIndexLayer) == 160, "MetaIndexLayer layout changed; bump kMetaIndexVersion.");
+static_assert(sizeof(MetaIndexSlot) == 16, "MetaIndexSlot layout changed; bump kMetaIndexVersion.");
+
+// True if 'path' starts with the index magic (cheap; reads 8 bytes).
+bool IsMetaIndexFile(const std::string& path);
+
+// Convert a dram_meta.json into a binary index at 'index_path'.
+void WriteMetaIndex(const std::string& json_path, const std::string& index_path);
+
+// Loader side (maps the index read-only; throws std::runtime_error on a
+// malformed or foreign-endian file).
+std::vector<LayerSpec> ParseMetaIndex(const std::string& index_path);
+void BuildDramFromMetaIndex(const std::string& index_path, sf::dram::SimpleDRAM& dram);
+
+} // namespace sf
@@ -45,13 +45,33 @@ struct LayerSpec {
   bool  has_w_scale   = false;
 };
 
+// Execution knobs. Only conv_dataflow, tile_order, chip and the model choices
+// in core (see CoreOptions) change modeled results; the rest are host-side.
+struct SimOptions {
+  int site_threads  = 1;  // ConvLayer::SetNumThreads
+  // Layers read their input spines from the preloaded DRAM image, not from the
+  // previous layer's output, so RunNetwork may run up to this many layers at
+  // once (each with site_threads workers). Rows are still reported in L order.
+  int layer_threads = 1;
+  CoreOptions core{};     // ConvLayer/FCLayer::SetCoreOptions
+  ConvDataflow conv_dataflow = ConvDataflow::kSiteMajor;  // ConvLayer::SetDataflow
+  TileOrderPolicy tile_order{};                           // ConvLayer::SetTileOrder
+  // Conv layers on chip.cores cores sharing one DRAM port (ConvLayer::SetChip);
+  // FC layers have a single output site and stay on one core.
+  ChipOptions chip{};
+  sf::dram::SimpleDRAM::Storage dram_storage = sf::dram::SimpleDRAM::Storage::kMapped;  // InitDram
+};
+
 std::vector<LayerSpec> ParseConfig(const std::string& json_path);
-sf::dram::SimpleDRAM InitDram(const std::string& bin_path, const std::string& json_path);
+sf::dram::SimpleDRAM InitDram(const std::string& bin_path, const std::string& json_path,
+                              sf::dram::SimpleDRAM::Storage storage =
+                                  sf::dram::SimpleDRAM::Storage::kMapped);
 
 // Layers own their engines; RunNetwork simply configures and runs them.
 void RunNetwork(const std::vector<LayerSpec>& specs,
                 sf::dram::SimpleDRAM* dram,
                 const std::string& repo_name,
-                const std::string& model_name);
+                const std::string& model_name,
+                const SimOptions& options = {});
 
 } // namespace sf
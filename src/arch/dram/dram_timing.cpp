@@ -0,0 +1,100 @@
+// dram_timing.cpp
+// All comments are in English.
+#include "arch/dram/dram_timing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace sf { namespace dram {
+
+FlatDramTiming::FlatDramTiming(double bytes_per_cycle, uint32_t overhead_cycles)
+  : bpc_(bytes_per_cycle), overhead_(overhead_cycles) {
+  if (bpc_ <= 0.0) throw std::invalid_argument("FlatDramTiming: bytes_per_cycle must be > 0.");
+}
+
+uint64_t FlatDramTiming::Cycles(const std::vector<DramRange>& ranges, bool /*write*/) {
+  uint64_t bytes = 0;
+  for (const DramRange& r : ranges) bytes += r.bytes;
+  if (bytes == 0) return 0;
+  ++stats_.transactions;
+  // Same rounding as IOShadow::BytesToCycles.
+  return static_cast<uint64_t>(std::llround(std::floor((bytes + bpc_ - 1.0) / bpc_))) + overhead_;
+}
+
+BankedDramTiming::BankedDramTiming(const BankedDramConfig& config) : config_(config) {
+  if (config_.channels == 0 || config_.banks == 0) {
+    throw std::invalid_argument("BankedDramTiming: channels and banks must be positive.");
+  }
+  if (config_.burst_bytes == 0 || config_.row_bytes < config_.burst_bytes ||
+      config_.row_bytes % config_.burst_bytes != 0) {
+    throw std::invalid_argument("BankedDramTiming: row_bytes must be a positive multiple of burst_bytes.");
+  }
+  if (config_.channel_bytes_per_cycle <= 0.0) {
+    throw std::invalid_argument("BankedDramTiming: channel_bytes_per_cycle must be > 0.");
+  }
+  bursts_per_row_ = config_.row_bytes / config_.burst_bytes;
+  const std::size_t slots = static_cast<std::size_t>(config_.channels) * config_.banks;
+  open_row_.assign(slots, -1);
+  bus_free_.assign(config_.channels, 0);
+  bank_free_.assign(slots, 0);
+}
+
+void BankedDramTiming::Reset() {
+  DramTiming::Reset();
+  std::fill(open_row_.begin(), open_row_.end(), -1);
+}
+
+uint64_t BankedDramTiming::Cycles(const std::vector<DramRange>& ranges, bool /*write*/) {
+  const uint64_t channels = config_.channels;
+  const uint64_t banks = config_.banks;
+  const uint64_t burst = config_.burst_bytes;
+  // Bytes of one row in every channel: a channel's bursts inside a stripe
+  // all fall into the same (bank, row).
+  const uint64_t stripe_bursts = bursts_per_row_ * channels;
+
+  std::fill(bus_free_.begin(), bus_free_.end(), 0);
+  std::fill(bank_free_.begin(), bank_free_.end(), 0);
+  bool any = false;
+  for (const DramRange& r : ranges) {
+    if (r.bytes == 0) continue;
+    any = true;
+    const uint64_t first = r.addr / burst;
+    const uint64_t last  = (r.addr + r.bytes - 1) / burst;  // inclusive
+    for (uint64_t lo = first; lo <= last;) {
+      const uint64_t stripe = lo / stripe_bursts;
+      const uint64_t hi = std::min(last, (stripe + 1) * stripe_bursts - 1);
+      const uint64_t bank = stripe % banks;
+      const int64_t  row  = static_cast<int64_t>(stripe / banks);
+      // Channel c gets the bursts b in [lo, hi] with b % channels == c.
+      for (uint64_t c = 0; c < channels; ++c) {
+        const uint64_t off = (c + channels - lo % channels) % channels;
+        if (lo + off > hi) continue;
+        const uint64_t n = (hi - lo - off) / channels + 1;
+        const std::size_t slot = static_cast<std::size_t>(c * banks + bank);
+        uint64_t ready = bank_free_[slot];
+        if (open_row_[slot] == row) {
+          stats_.row_hits += n;
+        } else {
+          open_row_[slot] = row;
+          ready += config_.row_miss_cycles;
+          stats_.row_misses += 1;
+          stats_.row_hits += n - 1;
+        }
+        // A run of bursts streams back to back on the data bus.
+        const uint64_t data = static_cast<uint64_t>(std::ceil(
+            static_cast<double>(n * burst) / config_.channel_bytes_per_cycle));
+        const uint64_t start = std::max(bus_free_[c], ready);
+        bus_free_[c]     = start + data;
+        bank_free_[slot] = bus_free_[c];
+        stats_.bursts += n;
+      }
+      lo = hi + 1;
+    }
+  }
+  if (!any) return 0;
+  ++stats_.transactions;
+  const uint64_t data = *std::max_element(bus_free_.begin(), bus_free_.end());
+  return config_.transaction_overhead_cycles + config_.row_hit_cycles + data;
+}
+
+}} // namespace sf::dram
@@ -0,0 +1,90 @@
+// mapped_file.cpp
+// All comments are in English.
+#include "arch/dram/mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SF_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sf { namespace dram {
+
+MappedFile::~MappedFile() { Reset_(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : data_(std::exchange(other.data_, nullptr)),
+    size_(std::exchange(other.size_, 0)),
+    mode_(other.mode_) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Reset_();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mode_ = other.mode_;
+  }
+  return *this;
+}
+
+bool MappedFile::Supported() {
+#ifdef SF_HAVE_MMAP
+  return true;
+#else
+  return false;
+#endif
+}
+
+MappedFile MappedFile::Open(const std::string& path, Mode mode) {
+#ifdef SF_HAVE_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("MappedFile::Open: cannot open " + path + ": " + std::strerror(errno));
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    const int err = errno;
+    ::close(fd);
+    throw std::runtime_error("MappedFile::Open: cannot stat " + path + ": " + std::strerror(err));
+  }
+
+  MappedFile f;
+  f.mode_ = mode;
+  f.size_ = static_cast<uint64_t>(st.st_size);
+  if (f.size_ > 0) {
+    const int prot  = (mode == Mode::kCopyOnWrite) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    const int flags = (mode == Mode::kCopyOnWrite) ? MAP_PRIVATE : MAP_SHARED;
+    void* p = ::mmap(nullptr, static_cast<size_t>(f.size_), prot, flags, fd, 0);
+    if (p == MAP_FAILED) {
+      const int err = errno;
+      ::close(fd);
+      throw std::runtime_error("MappedFile::Open: mmap failed for " + path + ": " + std::strerror(err));
+    }
+    f.data_ = static_cast<uint8_t*>(p);
+  }
+  // The mapping stays valid after the descriptor is closed.
+  ::close(fd);
+  return f;
+#else
+  (void)mode;
+  throw std::runtime_error("MappedFile::Open: memory mapping not supported on this platform: " + path);
+#endif
+}
+
+void MappedFile::Reset_() {
+#ifdef SF_HAVE_MMAP
+  if (data_ && size_ > 0) {
+    ::munmap(data_, static_cast<size_t>(size_));
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}} // namespace sf::dram
@@ -1,6 +1,7 @@
 // simple_dram.cpp
 // All comments are in English.
 #include "arch/dram/simple_dram.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iterator>
 #include <nlohmann/json.hpp>
@@ -16,9 +17,9 @@ namespace sf { namespace dram {
 
 void SimpleDRAM::LoadRawImage(const void* src, uint64_t n) {
   if (!src && n > 0) throw std::invalid_argument("LoadRawImage: null src with n>0");
-  if (n > mem_.size()) throw std::out_of_range("LoadRawImage: image larger than DRAM capacity");
+  if (n > capacity()) throw std::out_of_range("LoadRawImage: image larger than DRAM capacity");
   if (n > 0) {
-    std::memcpy(mem_.data(), src, static_cast<size_t>(n));
+    std::memcpy(base(), src, static_cast<size_t>(n));
   }
 }
 
@@ -42,7 +43,7 @@ void SimpleDRAM::BuildFromJson(const std::string& json_text) {
         sm.id   = spine_id;
         sm.addr = static_cast<uint64_t>(v.at("addr").get<uint64_t>());
         sm.size = static_cast<uint32_t>(v.at("size").get<uint64_t>());
-        meta.input_spines[spine_id] = sm;
+        meta.input_spines.Insert(spine_id, sm);
       }
     }
 
@@ -56,7 +57,7 @@ void SimpleDRAM::BuildFromJson(const std::string& json_text) {
         wm.tile = tile_id;
         wm.addr = static_cast<uint64_t>(v.at("addr").get<uint64_t>());
         wm.size = static_cast<uint32_t>(v.at("size").get<uint64_t>());
-        meta.weight_tiles[tile_id] = wm;
+        meta.weight_tiles.Insert(tile_id, wm);
       }
     }
 
@@ -72,11 +73,34 @@ void SimpleDRAM::BuildFromJson(const std::string& json_text) {
   }
 }
 
+void SimpleDRAM::CheckOutputRegionsDisjoint() const {
+  std::vector<std::pair<uint64_t, uint64_t>> regions;
+  regions.reserve(layers_.size());
+  layers_.ForEach([&regions](uint32_t, const LayerMeta& m) {
+    if (m.output_region_end > m.output_region_begin) {
+      regions.emplace_back(m.output_region_begin, m.output_region_end);
+    }
+  });
+  std::sort(regions.begin(), regions.end());
+  for (size_t i = 1; i < regions.size(); ++i) {
+    if (regions[i].first < regions[i - 1].second) {
+      throw std::logic_error("CheckOutputRegionsDisjoint: layer output regions overlap");
+    }
+  }
+}
+
+// Read the whole file straight into a pre-sized buffer (single copy).
 static std::vector<uint8_t> ReadAllBinary_(const std::string& path) {
-  std::ifstream ifs(path, std::ios::binary);
+  std::ifstream ifs(path, std::ios::binary | std::ios::ate);
   if (!ifs) throw std::runtime_error("FromFiles: cannot open bin file: " + path);
-  return std::vector<uint8_t>((std::istreambuf_iterator<char>(ifs)),
-                               std::istreambuf_iterator<char>());
+  const std::streamoff n = ifs.tellg();
+  if (n < 0) throw std::runtime_error("FromFiles: cannot size bin file: " + path);
+  std::vector<uint8_t> buf(static_cast<size_t>(n));
+  ifs.seekg(0);
+  if (n > 0 && !ifs.read(reinterpret_cast<char*>(buf.data()), n)) {
+    throw std::runtime_error("FromFiles: short read on bin file: " + path);
+  }
+  return buf;
 }
 
 static std::string ReadAllText_(const std::string& path) {
@@ -86,14 +110,22 @@ static std::string ReadAllText_(const std::string& path) {
                       std::istreambuf_iterator<char>());
 }
 
-SimpleDRAM SimpleDRAM::FromFiles(const std::string& bin_path, const std::string& json_path) {
-  // Read files
-  auto bin = ReadAllBinary_(bin_path);
-  auto jtxt = ReadAllText_(json_path);
+SimpleDRAM SimpleDRAM::FromImage(const std::string& bin_path, Storage storage) {
+  SimpleDRAM dram(0);
+  if (storage == Storage::kMapped && MappedFile::Supported()) {
+    // DRAM capacity is the image size, as for the copied image.
+    dram.mapped_ = MappedFile::Open(bin_path, MappedFile::Mode::kCopyOnWrite);
+  } else {
+    // The image buffer becomes the DRAM space; no second copy.
+    dram.mem_ = ReadAllBinary_(bin_path);
+  }
+  return dram;
+}
 
-  // Create DRAM with exact size and load image
-  SimpleDRAM dram(static_cast<uint64_t>(bin.size()));
-  dram.LoadRawImage(bin.data(), static_cast<uint64_t>(bin.size()));
+SimpleDRAM SimpleDRAM::FromFiles(const std::string& bin_path, const std::string& json_path,
+                                 Storage storage) {
+  auto jtxt = ReadAllText_(json_path);
+  SimpleDRAM dram = FromImage(bin_path, storage);
 
   // Build layer meta
   dram.BuildFromJson(jtxt);
@@ -1,7 +1,6 @@
 // All comments are in English.
 
 #include "arch/filter_buffer.hpp"
-#include <iostream>
 
 namespace sf {
 
@@ -32,50 +31,45 @@ void FilterBuffer::Configure(int C_in, int W_in,
 void FilterBuffer::Update(int h_out, int w_out) {
   h_out_cur_ = h_out;
   w_out_cur_ = w_out;
-}
-
-int FilterBuffer::ComputeRowId(std::uint32_t neuron_id) const {
-  // Guard configuration.
-  if (C_in_ <= 0 || W_in_ <= 0 || K_h_ <= 0 || K_w_ <= 0) return -1;
 
-  // 1) Input channel index from neuron_id and C_in_.
-  const int c_in = static_cast<int>(neuron_id % static_cast<std::uint32_t>(C_in_));
+  site_runs_.clear();
+  site_rows_.clear();
+  if (C_in_ <= 0 || W_in_ <= 0 || K_h_ <= 0 || K_w_ <= 0) return;
 
-  // 2) Decode input spatial (h_in, w_in) from neuron_id using W_in_.
-  //    neuron_id = C_in * (h_in * W_in + w_in) + c_in
-  const std::uint32_t pos_in = static_cast<std::uint32_t>(neuron_id / static_cast<std::uint32_t>(C_in_));
-  const int h_in = static_cast<int>(pos_in / static_cast<std::uint32_t>(W_in_));
-  const int w_in = static_cast<int>(pos_in % static_cast<std::uint32_t>(W_in_));
+  // Window origin in input coordinates:
+  //   r = h_in - (h_out_cur * S_h - P_h),  c = w_in - (w_out_cur * S_w - P_w)
+  const int h0 = h_out_cur_ * S_h_ - P_h_;
+  const int w0 = w_out_cur_ * S_w_ - P_w_;
+  // Kernel columns whose w_in lies inside the input row.
+  const int c_lo = std::max(0, -w0);
+  const int c_hi = std::min(K_w_, W_in_ - w0);
+  if (c_lo >= c_hi) return;
 
-  // 3) Compute kernel offsets (r,c) using current output site and stride/padding (members).
-  //    r = h_in - (h_out_cur * S_h - P_h)
-  //    c = w_in - (w_out_cur * S_w - P_w)
-  const int r = h_in - (h_out_cur_ * S_h_ - P_h_);
-  const int c = w_in - (w_out_cur_ * S_w_ - P_w_);
-
-  // 4) Check (r,c) within the kernel window.
-  if (r < 0 || r >= K_h_ || c < 0 || c >= K_w_) {
-    // std::cout << "Current hout=" << h_out_cur_ << ", wout=" << w_out_cur_ << "\n";
-    // std::cout << "(h_in, w_in)=(" << h_in << ", " << w_in << ")\n";
-    std::cout << "ComputeRowId: neuron_id=" << neuron_id
-              << " maps to (c_in=" << c_in << ", r=" << r << ", c=" << c << ") outside kernel window\n";
-    return -1; // invalid/padded tap
-  }
+  // neuron_id = C_in * (h_in * W_in + w_in) + c_in, so for a fixed h_in the
+  // taps c_lo..c_hi-1 (all channels) are one contiguous id run.
+  const std::uint32_t run_len = static_cast<std::uint32_t>((c_hi - c_lo) * C_in_);
+  for (int r = 0; r < K_h_; ++r) {
+    const int h_in = h0 + r;
+    if (h_in < 0) continue;
+    const std::int64_t begin =
+        static_cast<std::int64_t>(C_in_) * (static_cast<std::int64_t>(h_in) * W_in_ + (w0 + c_lo));
+    if (begin > static_cast<std::int64_t>(UINT32_MAX)) break;
 
-  // 5) Flatten (c_in, r, c) -> row_id
-  const long long row_id_ll =
-      (static_cast<long long>(c_in) * K_h_ + r) * K_w_ + c;
+    SiteRun run;
+    run.begin = static_cast<std::uint32_t>(begin);
+    run.len = run_len;
+    run.row_offset = static_cast<std::uint32_t>(site_rows_.size());
+    site_runs_.push_back(run);
 
-  if (row_id_ll < 0 || row_id_ll >= static_cast<long long>(kFilterRows)) {
-    std::cout << "ComputeRowId: neuron_id=" << neuron_id
-              << " maps to out-of-bounds row_id=" << row_id_ll
-              << " (c_in=" << c_in << ", r=" << r << ", c=" << c
-              << ", K_h=" << K_h_ << ", K_w=" << K_w_ <<
-            ")\n";
-    return -1; // storage bound check (fixed capacity)
+    for (int c = c_lo; c < c_hi; ++c) {
+      for (int c_in = 0; c_in < C_in_; ++c_in) {
+        // Flatten (c_in, r, c) -> row_id; storage bound check (fixed capacity).
+        const long long row_id_ll = (static_cast<long long>(c_in) * K_h_ + r) * K_w_ + c;
+        site_rows_.push_back(row_id_ll < static_cast<long long>(kFilterRows)
+                                 ? static_cast<int>(row_id_ll) : -1);
+      }
+    }
   }
-
-  return static_cast<int>(row_id_ll);
 }
 
 FilterBuffer::Row FilterBuffer::GetRow(int row_id) const {
@@ -88,20 +82,102 @@ FilterBuffer::Row FilterBuffer::GetRow(int row_id) const {
   return rows_[idx];
 }
 
+void FilterBuffer::SetPingPongSplit(std::uint32_t ping_rows) {
+  if (ping_rows == 0 || ping_rows >= kFilterRows) {
+    throw std::invalid_argument("FilterBuffer::SetPingPongSplit: split must leave rows in both halves.");
+  }
+  pingpong_split_ = ping_rows;
+}
+
+void FilterBuffer::SetRequestTrace(std::vector<std::uint32_t> trace) {
+  trace_ = std::move(trace);
+  next_use_.assign(trace_.size(), UINT64_MAX);
+  std::unordered_map<std::uint32_t, std::uint64_t> next_of_tile;
+  for (std::size_t i = trace_.size(); i-- > 0;) {
+    auto it = next_of_tile.find(trace_[i]);
+    if (it != next_of_tile.end()) next_use_[i] = it->second;
+    next_of_tile[trace_[i]] = i;
+  }
+  residency_.trace_pos = 0;
+  // Tiles still resident from an earlier trace: key them by their first
+  // request in this one.
+  if (policy_ == WeightCachePolicy::kBelady) {
+    for (std::size_t s = 0; s < residency_.slot_tile.size(); ++s) {
+      if (residency_.slot_tile[s] < 0) continue;
+      auto it = next_of_tile.find(static_cast<std::uint32_t>(residency_.slot_tile[s]));
+      residency_.slot_key[s] = it == next_of_tile.end() ? UINT64_MAX : it->second;
+    }
+  }
+}
+
 std::uint32_t FilterBuffer::LoadWeightFromDram(std::uint32_t total_tiles,
                                                std::uint32_t tile_id,
                                                std::uint32_t layer_id) {
   if (!dram_) {
     throw std::runtime_error("FilterBuffer::LoadWeightFromDram: DRAM pointer is null.");
   }
-  if (total_tiles == 0) {
-    throw std::invalid_argument("FilterBuffer::LoadWeightFromDram: total_tiles must be > 0.");
+
+  const LoadPlan plan = PlanLoad_(residency_, total_tiles, tile_id, policy_);
+  last_evicted_bytes_ = plan.evicted * BytesPerTile();
+  last_demand_bytes_ = 0;
+  last_prefetch_bytes_ = 0;
+  last_prefetch_tile_ = plan.prefetch;
+  last_demand_ranges_.clear();
+  last_prefetch_ranges_.clear();
+  if (plan.fetch.empty()) {
+    return 0; // already resident: active tile switched, no DRAM access
   }
 
-  // If already resident: make it active and return.
-  if (owned_tile_id_.count(tile_id)) {
-    active_tile_id_ = tile_id; // just switch active tile
-    return 0;                  // no DRAM access
+  const bool clear_all = (policy_ == WeightCachePolicy::kClearAll) ||
+                         (policy_ == WeightCachePolicy::kPingPong && !PingPongActive());
+  if (clear_all) {
+    // Clear existing storage (we refill from the requested tile forward).
+    for (auto& r : rows_) r.fill(0); // optional but keeps debugging clean
+  }
+
+  uint32_t total_bytes_loaded = 0;
+  for (const auto& [cur_id, base_row] : plan.fetch) {
+    // Timing accumulation (one transaction per tile)
+    const std::uint32_t bytes = FetchTile_(layer_id, cur_id, base_row);
+    const dram::DramRange range{dram_->layer_meta(layer_id).weight_tiles.Find(cur_id)->addr, bytes};
+    if (plan.prefetch && cur_id == *plan.prefetch) {
+      last_prefetch_bytes_ += bytes;
+      last_prefetch_ranges_.push_back(range);
+    } else {
+      last_demand_bytes_ += bytes;
+      last_demand_ranges_.push_back(range);
+    }
+    total_bytes_loaded += bytes;
+  }
+  return total_bytes_loaded;
+}
+
+std::uint32_t FilterBuffer::AdvanceResidency(Residency& r,
+                                             std::uint32_t total_tiles,
+                                             std::uint32_t tile_id,
+                                             WeightCachePolicy policy) const {
+  const LoadPlan plan = PlanLoad_(r, total_tiles, tile_id, policy);
+  return static_cast<std::uint32_t>(plan.fetch.size()) * BytesPerTile();
+}
+
+void FilterBuffer::RestoreResidency(const Residency& r, std::uint32_t layer_id) {
+  if (!dram_) {
+    throw std::runtime_error("FilterBuffer::RestoreResidency: DRAM pointer is null.");
+  }
+  for (auto& row : rows_) row.fill(0);
+  residency_ = r;
+  for (const auto& [cur_id, base_row] : residency_.tile_base_row) {
+    FetchTile_(layer_id, cur_id, base_row);
+  }
+}
+
+FilterBuffer::LoadPlan FilterBuffer::PlanLoad_(Residency& r,
+                                               std::uint32_t total_tiles,
+                                               std::uint32_t tile_id,
+                                               WeightCachePolicy policy) const {
+  LoadPlan plan;
+  if (total_tiles == 0) {
+    throw std::invalid_argument("FilterBuffer::LoadWeightFromDram: total_tiles must be > 0.");
   }
 
   // Compute rows per tile and capacity checks.
@@ -116,40 +192,154 @@ std::uint32_t FilterBuffer::LoadWeightFromDram(std::uint32_t total_tiles,
   if (tiles_capacity == 0) {
     throw std::logic_error("FilterBuffer::LoadWeightFromDram: tiles_capacity computed as 0.");
   }
+  if (policy == WeightCachePolicy::kPingPong) {
+    if (PingPongActive()) {
+      PlanPingPong_(r, total_tiles, tile_id, plan);
+      return plan;
+    }
+    policy = WeightCachePolicy::kClearAll;  // tiles do not fit in a half
+  }
+  if (r.slot_tile.size() != tiles_capacity) {
+    r.slot_tile.assign(tiles_capacity, -1);
+    r.slot_key.assign(tiles_capacity, 0);
+    for (const auto& [id, base] : r.tile_base_row) {
+      r.slot_tile[base / static_cast<uint32_t>(rows_per_tile)] = id;
+    }
+  }
 
-  // Clear existing residency (we will refill from the requested tile forward).
-  ClearAllOwnership();
-  for (auto& r : rows_) r.fill(0); // optional but keeps debugging clean
+  // Replacement key of this access.
+  std::uint64_t key = 0;
+  if (policy == WeightCachePolicy::kLru) {
+    key = ++r.clock;
+  } else if (policy == WeightCachePolicy::kBelady) {
+    if (r.trace_pos >= trace_.size() || trace_[r.trace_pos] != tile_id) {
+      throw std::logic_error("FilterBuffer::LoadWeightFromDram: request does not match the Belady trace.");
+    }
+    key = next_use_[r.trace_pos++];
+  }
 
-  // Byte math per tile and per-transaction timing
-  const uint32_t bytes_per_tile = static_cast<uint32_t>(rows_per_tile) * kNumPE * sizeof(std::int8_t);
+  // If already resident: make it active and return.
+  auto hit = r.tile_base_row.find(tile_id);
+  if (hit != r.tile_base_row.end()) {
+    r.active_tile_id = tile_id; // just switch active tile
+    r.slot_key[hit->second / static_cast<uint32_t>(rows_per_tile)] = key;
+    return plan;
+  }
+
+  if (policy != WeightCachePolicy::kClearAll) {
+    // Per-slot load: a free slot, else the victim with the smallest LRU stamp
+    // or the farthest next use.
+    std::size_t slot = tiles_capacity;
+    for (std::size_t s = 0; s < tiles_capacity && slot == tiles_capacity; ++s) {
+      if (r.slot_tile[s] < 0) slot = s;
+    }
+    if (slot == tiles_capacity) {
+      slot = 0;
+      for (std::size_t s = 1; s < tiles_capacity; ++s) {
+        const bool better = (policy == WeightCachePolicy::kLru)
+                                ? r.slot_key[s] < r.slot_key[slot]
+                                : r.slot_key[s] > r.slot_key[slot];
+        if (better) slot = s;
+      }
+      r.tile_base_row.erase(static_cast<std::uint32_t>(r.slot_tile[slot]));
+      plan.evicted = 1;
+    }
+    const uint32_t base_row = static_cast<uint32_t>(slot) * static_cast<uint32_t>(rows_per_tile);
+    r.slot_tile[slot] = tile_id;
+    r.slot_key[slot] = key;
+    r.tile_base_row[tile_id] = base_row;
+    r.active_tile_id = tile_id;
+    plan.fetch.emplace_back(tile_id, base_row);
+    return plan;
+  }
+
+  // Clear existing residency (we will refill from the requested tile forward).
+  plan.evicted = static_cast<std::uint32_t>(r.tile_base_row.size());
+  r.tile_base_row.clear();
+  r.active_tile_id.reset();
+  std::fill(r.slot_tile.begin(), r.slot_tile.end(), -1);
 
   // How many tiles to load this time (fill as much as possible)
   const uint32_t tiles_to_load = std::min<uint32_t>(tiles_capacity, total_tiles);
 
-  uint32_t total_bytes_loaded = 0;
-  uint32_t base_row           = 0;
-
+  FetchList& fetch = plan.fetch;
+  fetch.reserve(tiles_to_load);
+  uint32_t base_row = 0;
   for (uint32_t i = 0; i < tiles_to_load; ++i) {
     const uint32_t cur_id = (tile_id + i) % total_tiles;
-
-    // Destination pointer starts at rows_[base_row]
-    void* dst = static_cast<void*>(const_cast<std::int8_t*>(rows_[base_row].data()));
-    const uint32_t n = dram_->LoadWeightTile(layer_id, cur_id, dst, bytes_per_tile);
     // Record residency and base row mapping
-    owned_tile_id_.insert(cur_id);
-    tile_base_row_[cur_id] = base_row;
+    r.tile_base_row[cur_id] = base_row;
+    r.slot_tile[i] = cur_id;
+    fetch.emplace_back(cur_id, base_row);
 
     // Set the first one as active
-    if (i == 0) active_tile_id_ = cur_id;
-
-    // Timing accumulation (one transaction per tile)
-    total_bytes_loaded += n;
+    if (i == 0) r.active_tile_id = cur_id;
 
     base_row += static_cast<uint32_t>(rows_per_tile);
     if (base_row >= kFilterRows) break; // safety guard; should match tiles_to_load anyway
   }
+  return plan;
+}
+
+void FilterBuffer::PlanPingPong_(Residency& r,
+                                 std::uint32_t total_tiles,
+                                 std::uint32_t tile_id,
+                                 LoadPlan& plan) const {
+  const std::uint32_t base[2] = {0u, pingpong_split_};
+  if (r.slot_tile.size() != 2) {
+    r.slot_tile.assign(2, -1);
+    r.slot_key.assign(2, 0);
+    r.tile_base_row.clear();
+    r.active_tile_id.reset();
+  }
 
-  return total_bytes_loaded;
+  // Next request: from the trace if one is set, else the next tile id.
+  std::optional<std::uint32_t> next;
+  if (!trace_.empty()) {
+    if (r.trace_pos >= trace_.size() || trace_[r.trace_pos] != tile_id) {
+      throw std::logic_error("FilterBuffer::LoadWeightFromDram: request does not match the request trace.");
+    }
+    ++r.trace_pos;
+    if (r.trace_pos < trace_.size()) next = trace_[r.trace_pos];
+  } else if (total_tiles > 1) {
+    next = (tile_id + 1) % total_tiles;
+  }
+
+  // Put `id` into slot `s`, dropping its previous tile.
+  auto place = [&](std::size_t s, std::uint32_t id) {
+    if (r.slot_tile[s] >= 0) {
+      r.tile_base_row.erase(static_cast<std::uint32_t>(r.slot_tile[s]));
+      ++plan.evicted;
+    }
+    r.slot_tile[s] = id;
+    r.tile_base_row[id] = base[s];
+    plan.fetch.emplace_back(id, base[s]);
+  };
+
+  // Demand: a hit stays where it is; a miss takes the half that does not hold
+  // the currently active tile.
+  std::size_t slot = 0;
+  if (r.slot_tile[1] == static_cast<std::int64_t>(tile_id)) {
+    slot = 1;
+  } else if (r.slot_tile[0] != static_cast<std::int64_t>(tile_id)) {
+    const bool active0 = r.active_tile_id && r.slot_tile[0] == static_cast<std::int64_t>(*r.active_tile_id);
+    slot = active0 ? 1 : 0;
+    place(slot, tile_id);
+  }
+  r.active_tile_id = tile_id;
+
+  // Prefetch the next request into the other half while this tile computes.
+  if (next && *next != tile_id && !r.tile_base_row.count(*next)) {
+    place(1 - slot, *next);
+    plan.prefetch = *next;
+  }
+}
+
+std::uint32_t FilterBuffer::FetchTile_(std::uint32_t layer_id,
+                                       std::uint32_t tile_id,
+                                       std::uint32_t base_row) {
+  // Destination pointer starts at rows_[base_row]
+  void* dst = static_cast<void*>(rows_[base_row].data());
+  return dram_->LoadWeightTile(layer_id, tile_id, dst, BytesPerTile());
 }
 }
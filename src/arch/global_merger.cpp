@@ -16,10 +16,37 @@ bool GlobalMerger::run(Entry& out) {
   }
 
   // Step 2: Iterate all IntermediateFIFOs and select the smallest head entry.
-  bool found = false;
   std::size_t best_idx = 0;
   Entry best_entry{};
+  if (!FindBest_(best_idx, best_entry)) {
+    // No available entries in all FIFOs.
+    return false;
+  }
 
+  // Step 3: Pop from the winning FIFO and return the entry.
+  PopFrom_(best_idx);
+  out = best_entry;
+  return true;
+}
+
+std::size_t GlobalMerger::RunSameTs(Entry* out, std::size_t max) {
+  if (max == 0 || !run(out[0])) {
+    return 0;
+  }
+  std::size_t n = 1;
+  std::size_t idx = 0;
+  Entry next{};
+  // Entries of one timestamp can be integrated together; a later one must
+  // wait for the next cycle.
+  while (n < max && FindBest_(idx, next) && next.ts == out[0].ts) {
+    PopFrom_(idx);
+    out[n++] = next;
+  }
+  return n;
+}
+
+bool GlobalMerger::FindBest_(std::size_t& best_idx, Entry& best_entry) const {
+  bool found = false;
   for (std::size_t i = 0; i < kNumIntermediateFifos; ++i) {
     IntermediateFIFO& fifo = fifos_[i];
     if (fifo.empty()) continue;
@@ -28,7 +55,7 @@ bool GlobalMerger::run(Entry& out) {
     std::optional<Entry> cand = fifo.front();
     if (!cand.has_value()) {
       // Invariant: empty()==false implies front() must have a value.
-      throw std::runtime_error("GlobalMerger::run: FIFO not empty but front() returned nullopt.");
+      throw std::runtime_error("GlobalMerger::FindBest_: FIFO not empty but front() returned nullopt.");
     }
 
     const Entry& e = *cand;
@@ -45,21 +72,14 @@ bool GlobalMerger::run(Entry& out) {
       }
     }
   }
+  return found;
+}
 
-  // No available entries in all FIFOs.
-  if (!found) {
-    return false;
-  }
-
-  // Step 3: Pop from the winning FIFO and return the entry.
-  IntermediateFIFO& winner = fifos_[best_idx];
-  if (!winner.pop()) {
+void GlobalMerger::PopFrom_(std::size_t idx) {
+  if (!fifos_[idx].pop()) {
     // Invariant: front() succeeded; pop() must succeed.
     throw std::runtime_error("GlobalMerger::run: FIFO pop() failed unexpectedly.");
   }
-
-  out = best_entry;
-  return true;
 }
 
 } // namespace sf
@@ -5,6 +5,9 @@
 // Include your DRAM header (adjust path if needed in your repo).
 #include "arch/dram/simple_dram.hpp"  // provides sf::dram::SimpleDRAM
 
+#include <functional>  // std::greater
+#include <utility>     // std::swap
+
 namespace sf {
 
 InputSpineBuffer::InputSpineBuffer(sf::dram::SimpleDRAM* dram)
@@ -12,6 +15,7 @@ InputSpineBuffer::InputSpineBuffer(sf::dram::SimpleDRAM* dram)
     entries_per_buf_(kIsbEntries),
     bytes_per_buf_(static_cast<std::size_t>(kIsbEntries) * sizeof(Entry)),
     buffers_(static_cast<size_t>(kNumPhysISB)),
+    data_(static_cast<size_t>(kNumPhysISB), nullptr),
     read_idx_(static_cast<size_t>(kNumPhysISB), 0),
     valid_count_(static_cast<size_t>(kNumPhysISB), 0),
     logical_id_loaded_(static_cast<size_t>(kNumPhysISB), -1),
@@ -23,6 +27,7 @@ InputSpineBuffer::InputSpineBuffer(sf::dram::SimpleDRAM* dram)
   // Allocate per-physical-buffer storage.
   for (int i = 0; i < num_phys_; ++i) {
     buffers_[static_cast<size_t>(i)].resize(static_cast<size_t>(entries_per_buf_));
+    data_[static_cast<size_t>(i)] = buffers_[static_cast<size_t>(i)].data();
   }
 }
 
@@ -30,6 +35,54 @@ void InputSpineBuffer::Reset() {
   std::fill(read_idx_.begin(), read_idx_.end(), 0);
   std::fill(valid_count_.begin(), valid_count_.end(), 0);
   std::fill(logical_id_loaded_.begin(), logical_id_loaded_.end(), -1);
+  shadow_valid_ = false;
+}
+
+void InputSpineBuffer::SetShadowBank(bool enable) {
+  shadow_enabled_ = enable;
+  shadow_valid_ = false;
+  if (enable && shadow_.buffers.empty()) {
+    const std::size_t n = static_cast<size_t>(num_phys_);
+    shadow_.buffers.assign(n, std::vector<Entry>(static_cast<size_t>(entries_per_buf_)));
+    shadow_.data.resize(n);
+    for (std::size_t i = 0; i < n; ++i) shadow_.data[i] = shadow_.buffers[i].data();
+    shadow_.read_idx.assign(n, 0);
+    shadow_.valid_count.assign(n, 0);
+    shadow_.logical_id_loaded.assign(n, -1);
+  }
+}
+
+bool InputSpineBuffer::PrefetchBatch(const std::vector<int>& logical_spine_ids, int layer_id) {
+  if (!shadow_enabled_) {
+    return false;
+  }
+  if (static_cast<int>(logical_spine_ids.size()) > num_phys_) {
+    throw std::invalid_argument("PrefetchBatch: more logical spines than physical buffers");
+  }
+  SwapBanks_();
+  LoadBatchIntoBuffers_(logical_spine_ids, layer_id);
+  SwapBanks_();
+  shadow_ids_ = logical_spine_ids;
+  shadow_valid_ = true;
+  return true;
+}
+
+bool InputSpineBuffer::TakeShadow_(const std::vector<int>& logical_spine_ids) {
+  if (!shadow_valid_ || shadow_ids_ != logical_spine_ids) {
+    return false;
+  }
+  SwapBanks_();
+  shadow_valid_ = false;
+  return true;
+}
+
+void InputSpineBuffer::SwapBanks_() {
+  buffers_.swap(shadow_.buffers);
+  data_.swap(shadow_.data);
+  read_idx_.swap(shadow_.read_idx);
+  valid_count_.swap(shadow_.valid_count);
+  logical_id_loaded_.swap(shadow_.logical_id_loaded);
+  std::swap(last_loaded_bytes_, shadow_.loaded_bytes);
 }
 
 bool InputSpineBuffer::PreloadFirstBatch(const std::vector<int>& logical_spine_ids_first_batch,
@@ -41,6 +94,9 @@ bool InputSpineBuffer::PreloadFirstBatch(const std::vector<int>& logical_spine_i
   if (static_cast<int>(logical_spine_ids_first_batch.size()) > num_phys_) {
     throw std::invalid_argument("PreloadFirstBatch: more logical spines than physical buffers");
   }
+  if (TakeShadow_(logical_spine_ids_first_batch)) {
+    return true;
+  }
   // Load into physical buffers and mark metadata.
   const uint64_t cycles = LoadBatchIntoBuffers_(logical_spine_ids_first_batch, layer_id);
   return true;
@@ -62,6 +118,9 @@ bool InputSpineBuffer::run(const std::vector<int>& logical_spine_ids_current_bat
   if (static_cast<int>(logical_spine_ids_current_batch.size()) > num_phys_) {
     throw std::invalid_argument("run(): more logical spines than physical buffers");
   }
+  if (TakeShadow_(logical_spine_ids_current_batch)) {
+    return true;
+  }
   // Perform the load.
   const uint64_t cycles = LoadBatchIntoBuffers_(logical_spine_ids_current_batch, layer_id);
   return true;
@@ -74,7 +133,7 @@ bool InputSpineBuffer::PopSmallestTsEntry(Entry& out) {
   // Scan all physical buffers for the smallest head timestamp.
   for (int i = 0; i < num_phys_; ++i) {
     if (Available_(i) <= 0) continue;
-    const Entry& head = buffers_[static_cast<size_t>(i)][static_cast<size_t>(read_idx_[static_cast<size_t>(i)])];
+    const Entry& head = Data_(i)[read_idx_[static_cast<size_t>(i)]];
     if (best_idx < 0 || head.ts < best_ts) {
       best_idx = i;
       best_ts = head.ts;
@@ -86,7 +145,7 @@ bool InputSpineBuffer::PopSmallestTsEntry(Entry& out) {
   }
 
   // Pop one entry from the chosen buffer.
-  out = buffers_[static_cast<size_t>(best_idx)][static_cast<size_t>(read_idx_[static_cast<size_t>(best_idx)])];
+  out = Data_(best_idx)[read_idx_[static_cast<size_t>(best_idx)]];
   read_idx_[static_cast<size_t>(best_idx)] += 1;
   // When a buffer becomes fully consumed, we leave it as empty (no auto-reload here).
   // std::cout << "Popped Entry from buffer " << best_idx << ": (ts=" << static_cast<int>(out.ts)
@@ -94,6 +153,39 @@ bool InputSpineBuffer::PopSmallestTsEntry(Entry& out) {
   return true;
 }
 
+std::size_t InputSpineBuffer::MergeInto(std::vector<Entry>& out) {
+  // k-way merge over the buffer heads. Keys pack (ts, buffer index) so the
+  // min-heap pops in exactly the PopSmallestTsEntry() order.
+  auto key = [this](int i) -> std::uint32_t {
+    const Entry& head = Data_(i)[read_idx_[static_cast<size_t>(i)]];
+    return (static_cast<std::uint32_t>(head.ts) << 16) | static_cast<std::uint32_t>(i);
+  };
+  std::vector<std::uint32_t> heap;
+  heap.reserve(static_cast<size_t>(num_phys_));
+  std::size_t total = 0;
+  for (int i = 0; i < num_phys_; ++i) {
+    if (Available_(i) <= 0) continue;
+    total += static_cast<std::size_t>(Available_(i));
+    heap.push_back(key(i));
+  }
+  const auto greater = std::greater<std::uint32_t>();
+  std::make_heap(heap.begin(), heap.end(), greater);
+  out.reserve(out.size() + total);
+
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    const int i = static_cast<int>(heap.back() & 0xFFFFu);
+    heap.pop_back();
+    out.push_back(Data_(i)[read_idx_[static_cast<size_t>(i)]]);
+    read_idx_[static_cast<size_t>(i)] += 1;
+    if (Available_(i) > 0) {
+      heap.push_back(key(i));
+      std::push_heap(heap.begin(), heap.end(), greater);
+    }
+  }
+  return total;
+}
+
 bool InputSpineBuffer::AllEmpty() const {
   for (int i = 0; i < num_phys_; ++i) {
     if (Available_(i) > 0) return false;
@@ -115,13 +207,29 @@ uint64_t InputSpineBuffer::LoadBatchIntoBuffers_(const std::vector<int>& logical
   // Load each provided logical spine into the corresponding physical buffer slot.
   for (int i = 0; i < static_cast<int>(logical_spine_ids.size()); ++i) {
     const int spine_id = logical_spine_ids[static_cast<size_t>(i)];
-    // Copy bytes directly into the physical buffer storage.
-    const std::uint32_t copied_bytes = dram_->LoadInputSpine(
-        static_cast<std::uint32_t>(layer_id),
-        static_cast<std::uint32_t>(spine_id),
-        static_cast<void*>(buffers_[static_cast<size_t>(i)].data()),
-        static_cast<std::uint32_t>(bytes_per_buf_)
-    );
+    std::uint32_t copied_bytes = 0;
+    const Entry* data = buffers_[static_cast<size_t>(i)].data();
+    const void* view = nullptr;
+    if (view_mode_) {
+      // Point at the spine in DRAM; same byte count as the copy below.
+      copied_bytes = dram_->ViewInputSpine(
+          static_cast<std::uint32_t>(layer_id),
+          static_cast<std::uint32_t>(spine_id),
+          view,
+          static_cast<std::uint32_t>(bytes_per_buf_));
+    }
+    if (view && reinterpret_cast<std::uintptr_t>(view) % alignof(Entry) == 0) {
+      data = static_cast<const Entry*>(view);
+    } else {
+      // Copy bytes directly into the physical buffer storage.
+      copied_bytes = dram_->LoadInputSpine(
+          static_cast<std::uint32_t>(layer_id),
+          static_cast<std::uint32_t>(spine_id),
+          static_cast<void*>(buffers_[static_cast<size_t>(i)].data()),
+          static_cast<std::uint32_t>(bytes_per_buf_)
+      );
+    }
+    data_[static_cast<size_t>(i)] = data;
 
     // Compute how many entries are valid (partial loads are allowed).
     const std::size_t entries = copied_bytes / sizeof(Entry);
@@ -44,15 +44,8 @@ bool MinFinderBatch::run(int current_batch_cursor, int batches_needed) {
     throw std::runtime_error("MinFinderBatch::run: FIFO push failed unexpectedly.");
   }
 
-  // 3) Update the flag for "last batch's first entry pushed".
-  //    If already true, we leave it unchanged. Otherwise:
-  if (!last_batch_first_entry_pushed) {
-    if (current_batch_cursor == (batches_needed - 1)) {
-      // We just pushed an entry for the last batch; mark the flag.
-      last_batch_first_entry_pushed = true;
-    }
-  }
-  ++entry_count_total;
+  // 3) Update the flag for "last batch's first entry pushed" (sticky).
+  OnEntryPushed(current_batch_cursor, batches_needed);
   return true;
 }
 
@@ -42,4 +42,17 @@ bool OutputSorter::Sort() {
   return true;
 }
 
+void OutputSorter::SetWidth(std::size_t width) {
+  if (width != 1 && width != 2 && width != 4 && width != 8) {
+    throw std::invalid_argument("OutputSorter::SetWidth: width must be 1, 2, 4 or 8.");
+  }
+  width_ = width;
+}
+
+std::size_t OutputSorter::SortCycle() {
+  std::size_t n = 0;
+  while (n < width_ && !out_spine_->IsFull() && Sort()) ++n;
+  return n;
+}
+
 } // namespace sf
@@ -1,38 +1,214 @@
 // All comments are in English.
 
 #include "arch/pe_array.hpp"
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace sf {
 
+namespace {
+
+// vmem[i] += float(w[i]) * scale over lanes [begin, kNumPE); lanes reaching
+// thr[i] are reset to 0 and get their bit set in 'mask' (zeroed by caller).
+void IntegrateScalar(float* vmem, const float* thr, const std::int8_t* w, float scale,
+                     std::size_t begin, PeMask& mask) {
+  for (std::size_t i = begin; i < kNumPE; ++i) {
+    const float v = vmem[i] + static_cast<float>(w[i]) * scale;
+    if (v >= thr[i]) {
+      vmem[i] = 0.0f;
+      mask[i / 64] |= std::uint64_t{1} << (i % 64);
+    } else {
+      vmem[i] = v;
+    }
+  }
+}
+
+// Integer mode: vmem[i] = sat(vmem[i] + w[i]) in [lo, hi]; lanes reaching
+// thr[i] are reset to 0 and get their bit set in 'mask' (zeroed by caller).
+void IntegrateFixed(std::int32_t* vmem, const std::int32_t* thr, const std::int8_t* w,
+                    std::int32_t lo, std::int32_t hi, PeMask& mask) {
+  for (std::size_t i = 0; i < kNumPE; ++i) {
+    const std::int64_t sum = std::int64_t{vmem[i]} + w[i];
+    const std::int32_t v = static_cast<std::int32_t>(std::clamp<std::int64_t>(sum, lo, hi));
+    if (v >= thr[i]) {
+      vmem[i] = 0;
+      mask[i / 64] |= std::uint64_t{1} << (i % 64);
+    } else {
+      vmem[i] = v;
+    }
+  }
+}
+
+#if defined(__AVX512F__)
+constexpr std::size_t kLanes = 16;
+
+// Returns the first lane left for the scalar tail.
+std::size_t IntegrateVector(float* vmem, const float* thr, const std::int8_t* w, float scale,
+                            PeMask& mask) {
+  const __m512 s = _mm512_set1_ps(scale);
+  std::size_t i = 0;
+  for (; i + kLanes <= kNumPE; i += kLanes) {
+    const __m128i wq = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i));
+    const __m512 wf = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(wq)), s);
+    const __m512 v = _mm512_add_ps(_mm512_loadu_ps(vmem + i), wf);
+    const __mmask16 ge = _mm512_cmp_ps_mask(v, _mm512_loadu_ps(thr + i), _CMP_GE_OQ);
+    _mm512_storeu_ps(vmem + i, _mm512_maskz_mov_ps(static_cast<__mmask16>(~ge), v));
+    mask[i / 64] |= static_cast<std::uint64_t>(ge) << (i % 64);
+  }
+  return i;
+}
+#elif defined(__AVX2__)
+constexpr std::size_t kLanes = 8;
+
+// Returns the first lane left for the scalar tail.
+std::size_t IntegrateVector(float* vmem, const float* thr, const std::int8_t* w, float scale,
+                            PeMask& mask) {
+  const __m256 s = _mm256_set1_ps(scale);
+  std::size_t i = 0;
+  for (; i + kLanes <= kNumPE; i += kLanes) {
+    const __m128i wq = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i));
+    const __m256 wf = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(wq)), s);
+    const __m256 v = _mm256_add_ps(_mm256_loadu_ps(vmem + i), wf);
+    const __m256 ge = _mm256_cmp_ps(v, _mm256_loadu_ps(thr + i), _CMP_GE_OQ);
+    _mm256_storeu_ps(vmem + i, _mm256_andnot_ps(ge, v));
+    mask[i / 64] |= static_cast<std::uint64_t>(_mm256_movemask_ps(ge)) << (i % 64);
+  }
+  return i;
+}
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+static_assert(64 % kLanes == 0, "a vector step must not straddle mask words");
+#endif
+
+} // namespace
+
 bool PEArray::run(FilterBuffer& fb) {
+  if (input_width_ > 1) {
+    // Fetch up to input_width_ same-ts entries from Global Merger.
+    const std::size_t n = gm_.RunSameTs(group_.data(), input_width_);
+    if (n == 0) {
+      return false;
+    }
+    for (std::size_t k = 0; k < n; ++k) {
+      group_rows_[k] = fb.ComputeRowId(group_[k].neuron_id);
+    }
+    RunEntries(group_.data(), group_rows_.data(), n, fb);
+    return true;
+  }
+
   // Try to fetch one entry from Global Merger.
   if (!gm_.run(gm_entry_)) {
     return false;
   }
 
-  // We have an input entry. Reset output slots for this step.
+  // We have an input entry. Reset the spike outputs for this step.
   ResetOutputSlots();
-
   // Fetch the corresponding weight row (ComputeRowId uses FilterBuffer's members).
   GetWeightRow(fb);
+  Integrate_();
+  last_input_count_ = 1;
+  return true; // ran
+}
 
-  // Drive all PEs for this step.
-  for (std::size_t pe_idx = 0; pe_idx < kNumPE; ++pe_idx) {
-    // Decode weight to float (fixed-point or scale)
-    float w_float = DecodeWeightToFloat(weight_row_[pe_idx]);
-    pe_array_[pe_idx].Process(gm_entry_.ts, w_float);
-    if (pe_array_[pe_idx].spiked()) {
-      Entry e{};
-      e.ts        = pe_array_[pe_idx].last_ts();
-      e.neuron_id = pe_array_[pe_idx].output_neuron_id();
-      out_spike_entries_[pe_idx] = e;          // set this PE's slot
-    } else {
-      out_spike_entries_[pe_idx] = std::nullopt; // explicitly empty
+void PEArray::RunEntry(const Entry& in, int row_id, FilterBuffer& fb) {
+  ResetOutputSlots();
+  gm_entry_ = in;
+  SelectWeightRow(fb, row_id);
+  Integrate_();
+  last_input_count_ = 1;
+}
+
+void PEArray::RunEntries(const Entry* in, const int* row_ids, std::size_t n, FilterBuffer& fb) {
+  if (n == 0 || n > input_width_) {
+    throw std::invalid_argument("PEArray::RunEntries: entry count must be in [1, input_width].");
+  }
+  if (n == 1) {
+    RunEntry(in[0], row_ids[0], fb);
+    return;
+  }
+  for (std::size_t k = 1; k < n; ++k) {
+    if (in[k].ts != in[0].ts) {
+      throw std::invalid_argument("PEArray::RunEntries: entries of one step must share a timestamp.");
     }
   }
+  // Chained stages in input order: the same vmem updates as n width-1 steps.
+  ResetOutputSlots();
+  for (std::size_t k = 0; k < n; ++k) {
+    gm_entry_ = in[k];
+    SelectWeightRow(fb, row_ids[k]);
+    Integrate_();
+  }
+  last_input_count_ = n;
+}
 
-  return true; // ran
+void PEArray::Integrate_() {
+  out_mask_.fill(0);
+
+  // Drive all PEs for this stage: accumulate, compare, masked reset.
+  if (vmem_mode_ != VmemMode::kFloat) {
+    IntegrateFixed(vmem_q_.data(), threshold_q_.data(), weight_row_.data(),
+                   vmem_q_min_, vmem_q_max_, out_mask_);
+  } else {
+    std::size_t tail = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    tail = IntegrateVector(vmem_.data(), threshold_.data(), weight_row_.data(), weight_scale_, out_mask_);
+#endif
+    IntegrateScalar(vmem_.data(), threshold_.data(), weight_row_.data(), weight_scale_, tail, out_mask_);
+  }
+
+  CompactSpikes_();
+}
+
+void PEArray::CompactSpikes_() {
+  // Compact the bitmask into the ascending list of spiking PEs.
+  out_ts_ = gm_entry_.ts;
+  const std::size_t begin = out_count_;
+  for (std::size_t w = 0; w < kPeMaskWords; ++w) {
+    for (std::uint64_t bits = out_mask_[w]; bits != 0; bits &= bits - 1) {
+      out_pes_[out_count_++] = static_cast<std::uint16_t>(w * 64 + LowestSetBit(bits));
+    }
+  }
+  if (out_count_ > begin) {
+    out_stage_end_[out_stages_++] = out_count_;
+  }
+}
+
+void PEArray::UpdateDecodedParams_() {
+  // std::ldexp(1.0f, -n) == 2^-n; otherwise fall back to the provided scale
+  // (should be 2^-n in your exporter).
+  weight_scale_ = (w_frac_bits_ >= 0) ? std::ldexp(1.0f, -w_frac_bits_)
+                                      : ((w_scale_ > 0.0f) ? w_scale_ : 1.0f);
+  if (vmem_mode_ == VmemMode::kFloat) return;
+
+  // Weight LSB = 2^-n.
+  int n = w_frac_bits_;
+  if (n < 0) {
+    int exp = 0;
+    if (std::frexp(weight_scale_, &exp) != 0.5f) {
+      throw std::invalid_argument(
+          "PEArray::SetVmemMode: integer vmem needs w_frac_bits or a power-of-two w_scale.");
+    }
+    n = 1 - exp;  // weight_scale_ == 0.5 * 2^exp == 2^-n
+  }
+
+  if (vmem_mode_ == VmemMode::kInt16) {
+    vmem_q_min_ = std::numeric_limits<std::int16_t>::min();
+    vmem_q_max_ = std::numeric_limits<std::int16_t>::max();
+  } else {
+    vmem_q_min_ = std::numeric_limits<std::int32_t>::min();
+    vmem_q_max_ = std::numeric_limits<std::int32_t>::max();
+  }
+  // vmem_q * 2^-n >= threshold  <=>  vmem_q >= ceil(threshold * 2^n).
+  const double thr_q = std::ceil(std::ldexp(static_cast<double>(threshold_[0]), n));
+  const double clamped = std::clamp(thr_q, static_cast<double>(vmem_q_min_),
+                                    static_cast<double>(vmem_q_max_));
+  threshold_q_.fill(static_cast<std::int32_t>(clamped));
 }
 
 void PEArray::ClearOutputSpikes() {
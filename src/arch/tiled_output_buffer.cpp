@@ -1,9 +1,9 @@
 // All comments are in English.
 
 #include "arch/tiled_output_buffer.hpp"
-#include "arch/pe_array.hpp"  // requires: out_spike_entries() returning fixed array of optionals
+#include "arch/pe_array.hpp"  // requires: compact spike list of the latest PE step
 #include <limits>
-#include <optional>            // for std::optional
+#include <utility>
 
 namespace sf {
 
@@ -18,94 +18,181 @@ bool TiledOutputBuffer::run(int tile_id) {
   last_emitted_entries_ = 0;
 
   // 1) If any FIFO is full, assert stall for the next cycle; do NOT return here.
-  bool any_full = false;
-  for (const auto& q : pe_fifos_) {
-    if (q.size() >= kLocalFifoDepth) {
-      any_full = true;
-      break;
-    }
-  }
+  const bool any_full = AnyLocalFifoFull();
   stall_next_cycle_ = any_full;
 
-  // 2) If NOT full, grab the outputs from PEArray and push them to per-PE FIFOs.
-  //    Contract: out_spike_entries() -> std::array<std::optional<Entry>, kNumPE>
+  // 2) If NOT full, grab the outputs from PEArray and push them to per-PE FIFOs,
+  //    one PE output stage (at most one entry per PE) at a time while no FIFO
+  //    is full. Stages left over stay in the PEArray, which holds until the
+  //    TOB has taken them.
   if (!any_full) {
-    const auto& outs = pe_array_.out_spike_entries();
-
-    bool saw_any = false;
-    // One pass: for each PE i, if outs[i] holds a value, push into pe_fifos_[i].
-    for (std::size_t i = 0; i < kNumPE; ++i) {
-      if (outs[i].has_value()) {
-        // Since we checked "any_full" above and each PE contributes at most one
-        // entry per cycle, pushing one more cannot overflow beyond depth=4 here.
-        pe_fifos_[i].push_back(*outs[i]);
-        saw_any = true;
-        ++last_ingested_entries_;
+    while (pe_array_.has_output_spikes() && !AnyLocalFifoFull()) {
+      const std::size_t n = pe_array_.out_spike_count();
+      // One pass over the spiking PEs only: push each into its PE's local FIFO.
+      for (std::size_t k = 0; k < n; ++k) {
+        // No FIFO is full and a stage has one entry per PE at most, so
+        // pushing one more cannot overflow the FIFO depth here.
+        FifoPush_(pe_array_.out_spike_pe(k), pe_array_.out_spike_entry(k));
       }
-    }
-    if (saw_any) {
-      pe_array_.ClearOutputSpikes();
+      last_ingested_entries_ += n;
+      pe_array_.PopOutputStage();
       processed = true;
     }
   }
 
-  // 3) Pick the smallest-ts among all FIFO heads.
-  int best_pe = -1;
-  int best_ts = std::numeric_limits<int>::max();
+  // 3) Emit up to emit_width_ entries (smallest ts first) to the given tile buffer.
+  last_emitted_entries_ = EmitCycle_(tile_id);
+  if (last_emitted_entries_ > 0) {
+    processed = true;
+  }
+
+  return processed;
+}
+
+void TiledOutputBuffer::SetEmitWidth(std::size_t width) {
+  if (width != 1 && width != 2 && width != 4 && width != 8) {
+    throw std::invalid_argument("TiledOutputBuffer::SetEmitWidth: width must be 1, 2, 4 or 8.");
+  }
+  emit_width_ = width;
+}
+
+std::size_t TiledOutputBuffer::EmitCycle_(int tile_id) {
+  std::size_t n = 0;
+  while (n < emit_width_ && EmitOne_(tile_id)) ++n;
+  return n;
+}
 
-  for (std::size_t i = 0; i < kNumPE; ++i) {
-    auto& q = pe_fifos_[i];
-    if (!q.empty()) {
-      // Replace '.ts' below if your Entry uses a different timestamp field.
-      const int ts = static_cast<int>(q.front().ts);
+bool TiledOutputBuffer::EmitOne_(int tile_id) {
+  // Pick the smallest-ts among all FIFO heads: walk the set bits of the
+  // occupancy mask in ascending PE order, so ties keep the lowest PE index.
+  std::size_t best_pe = kNumPE;
+  unsigned best_ts = std::numeric_limits<unsigned>::max();
+  for (std::size_t w = 0; w < kPeMaskWords; ++w) {
+    for (std::uint64_t bits = nonempty_mask_[w]; bits != 0; bits &= bits - 1) {
+      const std::size_t pe = w * 64 + LowestSetBit(bits);
+      const unsigned ts = head_ts_[pe];
       if (ts < best_ts) {
         best_ts = ts;
-        best_pe = static_cast<int>(i);
+        best_pe = pe;
+        if (ts == 0) break;  // nothing can beat ts 0 (later PEs lose ties)
       }
     }
+    if (best_ts == 0) break;
+  }
+  if (best_pe == kNumPE) {
+    return false;
   }
 
-  // 4) Emit exactly one entry (the smallest ts) to the given tile buffer.
-  if (best_pe >= 0) {
-    Entry chosen = pe_fifos_[static_cast<std::size_t>(best_pe)].front();
-    pe_fifos_[static_cast<std::size_t>(best_pe)].erase(
-        pe_fifos_[static_cast<std::size_t>(best_pe)].begin());
+  tile_buffers_.at(static_cast<std::size_t>(tile_id)).push_back(FifoFront_(best_pe));
+  FifoPop_(best_pe);
+  return true;
+}
+
+void TiledOutputBuffer::FifoPush_(std::size_t pe, const Entry& e) {
+  const std::size_t n = fifo_size_[pe];
+  if (n >= kLocalFifoDepth) {
+    throw std::logic_error("TiledOutputBuffer::FifoPush_: local FIFO overflow.");
+  }
+  fifo_slots_[pe * kLocalFifoDepth + (fifo_head_[pe] + n) % kLocalFifoDepth] = e;
+  fifo_size_[pe] = static_cast<std::uint8_t>(n + 1);
+  const std::uint64_t bit = std::uint64_t{1} << (pe % 64);
+  if (n == 0) {
+    head_ts_[pe] = e.ts;
+    nonempty_mask_[pe / 64] |= bit;
+  }
+  if (n + 1 == kLocalFifoDepth) full_mask_[pe / 64] |= bit;
+}
 
-    auto& vec = tile_buffers_.at(static_cast<std::size_t>(tile_id));
-    if (vec.size() > vec.max_size() - 1) {
-      throw std::runtime_error("TiledOutputBuffer::run: tile buffer overflow.");
-    }
-    vec.push_back(chosen);
-    last_emitted_entries_ = 1;
-    processed = true;
+void TiledOutputBuffer::FifoPop_(std::size_t pe) {
+  const std::size_t n = fifo_size_[pe];
+  const std::uint64_t bit = std::uint64_t{1} << (pe % 64);
+  full_mask_[pe / 64] &= ~bit;
+  fifo_head_[pe] = static_cast<std::uint8_t>((fifo_head_[pe] + 1) % kLocalFifoDepth);
+  fifo_size_[pe] = static_cast<std::uint8_t>(n - 1);
+  if (n == 1) {
+    nonempty_mask_[pe / 64] &= ~bit;
+  } else {
+    head_ts_[pe] = FifoFront_(pe).ts;
   }
+}
 
-  return processed;
+std::size_t TiledOutputBuffer::DrainWhileStalled(int tile_id) {
+  if (tile_id < 0 || static_cast<std::size_t>(tile_id) >= kTilesPerSpine) {
+    throw std::out_of_range("TiledOutputBuffer::DrainWhileStalled: tile_id out of range.");
+  }
+  std::size_t cycles = 0;
+  std::size_t emitted = 0;
+  std::size_t last = 0;
+  // A full FIFO is non-empty, so every stalled cycle emits at least one entry.
+  while (AnyLocalFifoFull()) {
+    last = EmitCycle_(tile_id);
+    emitted += last;
+    ++cycles;
+  }
+  last_drain_emitted_entries_ = emitted;
+  if (cycles > 0) {
+    stall_next_cycle_ = true;
+    last_ingested_entries_ = 0;
+    last_emitted_entries_ = last;
+  }
+  return cycles;
 }
 
 bool TiledOutputBuffer::PeekTileHead(std::size_t tile_id, Entry& out) const {
   if (tile_id >= kTilesPerSpine) return false;
-  const auto& vec = tile_buffers_[tile_id];
-  if (vec.empty()) return false;
-  out = vec.front();
+  const auto& q = tile_buffers_[tile_id];
+  if (q.empty()) return false;
+  out = q.front();
   return true;
 }
 
 bool TiledOutputBuffer::PopTileHead(std::size_t tile_id, Entry& out) {
   if (tile_id >= kTilesPerSpine) return false;
-  auto& vec = tile_buffers_[tile_id];
-  if (vec.empty()) return false;
-  out = vec.front();
-  vec.erase(vec.begin());
+  auto& q = tile_buffers_[tile_id];
+  if (q.empty()) return false;
+  out = q.front();
+  q.pop_front();
   return true;
 }
 
 void TiledOutputBuffer::ClearAll() {
-  for (auto& v : tile_buffers_) v.clear();
-  for (auto& q : pe_fifos_)    q.clear();
+  for (auto& q : tile_buffers_) q.clear();
+  fifo_head_.fill(0);
+  fifo_size_.fill(0);
+  nonempty_mask_.fill(0);
+  full_mask_.fill(0);
   stall_next_cycle_ = false;
   last_ingested_entries_ = 0;
   last_emitted_entries_ = 0;
 }
 
+TiledOutputBuffer::State TiledOutputBuffer::TakeState() {
+  State s;
+  s.fifo_slots = fifo_slots_;
+  s.fifo_head = fifo_head_;
+  s.fifo_size = fifo_size_;
+  s.head_ts = head_ts_;
+  s.nonempty_mask = nonempty_mask_;
+  s.full_mask = full_mask_;
+  s.tile_buffers = std::move(tile_buffers_);
+  s.stall_next_cycle = stall_next_cycle_;
+  s.last_ingested_entries = last_ingested_entries_;
+  s.last_emitted_entries = last_emitted_entries_;
+  ClearAll();
+  return s;
+}
+
+void TiledOutputBuffer::RestoreState(State&& s) {
+  fifo_slots_ = s.fifo_slots;
+  fifo_head_ = s.fifo_head;
+  fifo_size_ = s.fifo_size;
+  head_ts_ = s.head_ts;
+  nonempty_mask_ = s.nonempty_mask;
+  full_mask_ = s.full_mask;
+  tile_buffers_ = std::move(s.tile_buffers);
+  stall_next_cycle_ = s.stall_next_cycle;
+  last_ingested_entries_ = s.last_ingested_entries;
+  last_emitted_entries_ = s.last_emitted_entries;
+}
+
 } // namespace sf
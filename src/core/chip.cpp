@@ -0,0 +1,222 @@
+// All comments are in English.
+#include "core/chip.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+
+namespace sf {
+
+SitePartitionPolicy RoundRobinSites() {
+  return [](int cores, int H_out, int W_out, const std::vector<std::uint64_t>& /*site_work*/,
+            std::vector<int>& core_of_site) {
+    core_of_site.resize(static_cast<std::size_t>(H_out) * static_cast<std::size_t>(W_out));
+    for (std::size_t s = 0; s < core_of_site.size(); ++s) {
+      core_of_site[s] = static_cast<int>(s % static_cast<std::size_t>(cores));
+    }
+  };
+}
+
+SitePartitionPolicy SpikeBalancedSites() {
+  return [](int cores, int H_out, int W_out, const std::vector<std::uint64_t>& site_work,
+            std::vector<int>& core_of_site) {
+    const std::size_t sites = static_cast<std::size_t>(H_out) * static_cast<std::size_t>(W_out);
+    core_of_site.assign(sites, 0);
+    std::vector<std::size_t> order(sites);
+    for (std::size_t s = 0; s < sites; ++s) order[s] = s;
+    auto work = [&](std::size_t s) { return s < site_work.size() ? site_work[s] : 0; };
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return work(a) > work(b); });
+    // (load, core): ties go to the lower core.
+    using Load = std::pair<std::uint64_t, int>;
+    std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+    for (int c = 0; c < cores; ++c) loads.push({0, c});
+    for (const std::size_t s : order) {
+      Load least = loads.top();
+      loads.pop();
+      core_of_site[s] = least.second;
+      least.first += work(s) + 1;  // +1: an empty site still costs its tiles
+      loads.push(least);
+    }
+  };
+}
+
+SitePartitionPolicy SpatialBlockSites() {
+  return [](int cores, int H_out, int W_out, const std::vector<std::uint64_t>& /*site_work*/,
+            std::vector<int>& core_of_site) {
+    // rows x cols == cores with the cut count along each axis following its length.
+    int rows = 1;
+    for (int d = 1; d * d <= cores; ++d) {
+      if (cores % d == 0) rows = d;
+    }
+    int cols = cores / rows;
+    if (H_out > W_out) std::swap(rows, cols);
+    core_of_site.resize(static_cast<std::size_t>(H_out) * static_cast<std::size_t>(W_out));
+    for (int h = 0; h < H_out; ++h) {
+      const int band_h = static_cast<int>(static_cast<long long>(h) * rows / H_out);
+      for (int w = 0; w < W_out; ++w) {
+        const int band_w = static_cast<int>(static_cast<long long>(w) * cols / W_out);
+        core_of_site[static_cast<std::size_t>(h) * static_cast<std::size_t>(W_out) +
+                     static_cast<std::size_t>(w)] = band_h * cols + band_w;
+      }
+    }
+  };
+}
+
+Chip::Chip(const ChipOptions& options) : options_(options) {
+  if (options_.cores <= 0) {
+    throw std::invalid_argument("Chip::Chip: cores must be positive.");
+  }
+  if (options_.dram_bytes_per_cycle <= 0.0) {
+    throw std::invalid_argument("Chip::Chip: dram_bytes_per_cycle must be > 0.");
+  }
+}
+
+void Chip::Run(int H_out, int W_out, const std::vector<std::uint64_t>& site_work,
+               const CoreFactory& make_core, const SiteRunner& run_site, int host_threads) {
+  const int cores = options_.cores;
+  const std::size_t sites = static_cast<std::size_t>(H_out) * static_cast<std::size_t>(W_out);
+
+  std::vector<int> core_of_site;
+  const SitePartitionPolicy& partition =
+      options_.partition ? options_.partition : RoundRobinSites();
+  partition(cores, H_out, W_out, site_work, core_of_site);
+  if (core_of_site.size() != sites) {
+    throw std::invalid_argument("Chip::Run: site partition must assign every site.");
+  }
+  std::vector<std::vector<int>> core_sites(static_cast<std::size_t>(cores));
+  for (std::size_t s = 0; s < sites; ++s) {
+    const int c = core_of_site[s];
+    if (c < 0 || c >= cores) {
+      throw std::invalid_argument("Chip::Run: site partition returned a core out of range.");
+    }
+    core_sites[static_cast<std::size_t>(c)].push_back(static_cast<int>(s));
+  }
+
+  struct CoreResult {
+    CoreCycleStats cycles{};
+    CoreSramStats  sram{};
+    int            drained_entries = 0;
+    std::vector<DramTransfer> trace;
+    std::unique_ptr<dram::DramTiming> link;  // the core's own DRAM timing
+    std::exception_ptr error;
+  };
+  std::vector<CoreResult> results(static_cast<std::size_t>(cores));
+
+  // Cores are independent until the DRAM replay; a host thread runs one
+  // core at a time so at most host_threads cores are alive.
+  std::atomic<int> next{0};
+  auto worker = [&]() {
+    for (int c = next++; c < cores; c = next++) {
+      CoreResult& res = results[static_cast<std::size_t>(c)];
+      const std::vector<int>& mine = core_sites[static_cast<std::size_t>(c)];
+      if (mine.empty()) continue;
+      try {
+        std::unique_ptr<Core> core = make_core(mine);
+        core->SetDramTrace(true);
+        core->SetStoreSlot(c, cores);
+        core->ResetCycleStats();
+        for (const int site : mine) {
+          run_site(*core, site, res.drained_entries);
+        }
+        core->FlushOverlappedStores();
+        res.cycles = core->GetCycleStats();
+        res.sram   = core->GetSramStats();
+        res.trace  = core->dram_trace();
+        res.link   = core->dram_timing().Clone();
+      } catch (...) {
+        res.error = std::current_exception();
+      }
+    }
+  };
+  const int workers = std::max(1, std::min(host_threads, cores));
+  std::vector<std::thread> threads;
+  threads.reserve(static_cast<std::size_t>(workers) - 1);
+  for (int t = 1; t < workers; ++t) threads.emplace_back(worker);
+  worker();
+  for (auto& t : threads) t.join();
+
+  stats_ = ChipStats{};
+  stats_.cores.resize(static_cast<std::size_t>(cores));
+  cycle_stats_ = {};
+  sram_stats_  = {};
+  drained_entries_ = 0;
+  std::vector<std::vector<DramTransfer>> traces(static_cast<std::size_t>(cores));
+  for (int c = 0; c < cores; ++c) {
+    CoreResult& res = results[static_cast<std::size_t>(c)];
+    if (res.error) std::rethrow_exception(res.error);
+    ChipCoreStats& cs = stats_.cores[static_cast<std::size_t>(c)];
+    cs.sites  = static_cast<int>(core_sites[static_cast<std::size_t>(c)].size());
+    cs.cycles = res.cycles;
+    cs.busy_cycles = res.cycles.load_cycles + res.cycles.compute_cycles + res.cycles.store_cycles;
+    for (const DramTransfer& x : res.trace) cs.dram_bytes += x.bytes;
+    if (cs.sites > 0) {
+      Accumulate(cycle_stats_, res.cycles);
+      Accumulate(sram_stats_, res.sram);
+    }
+    drained_entries_ += res.drained_entries;
+    traces[static_cast<std::size_t>(c)] = std::move(res.trace);
+  }
+
+  const dram::FlatDramTiming flat_port(options_.dram_bytes_per_cycle);
+  const dram::DramTiming& port = options_.dram_timing ? *options_.dram_timing : flat_port;
+  const std::vector<std::uint64_t> shared = ReplayDram(traces, port, &stats_.dram_busy_cycles);
+  for (int c = 0; c < cores; ++c) {
+    ChipCoreStats& cs = stats_.cores[static_cast<std::size_t>(c)];
+    const CoreResult& res = results[static_cast<std::size_t>(c)];
+    if (!res.link) continue;  // no sites, no transfers
+    // The core model already waits for its own transfers on its own link.
+    const std::uint64_t alone = ReplayDram({traces[static_cast<std::size_t>(c)]}, *res.link, nullptr)[0];
+    const std::uint64_t stall = shared[static_cast<std::size_t>(c)];
+    cs.dram_stall_cycles = (stall > alone) ? stall - alone : 0;
+    stats_.makespan = std::max(stats_.makespan, cs.busy_cycles + cs.dram_stall_cycles);
+  }
+}
+
+std::vector<std::uint64_t> Chip::ReplayDram(const std::vector<std::vector<DramTransfer>>& traces,
+                                            const dram::DramTiming& timing,
+                                            std::uint64_t* port_busy_cycles) {
+  std::unique_ptr<dram::DramTiming> port = timing.Clone();
+  port->Reset();
+  const std::size_t n = traces.size();
+  std::vector<std::vector<DramTransfer>> sorted(traces);
+  for (auto& trace : sorted) {
+    std::stable_sort(trace.begin(), trace.end(),
+                     [](const DramTransfer& a, const DramTransfer& b) { return a.issue < b.issue; });
+  }
+
+  // (issue shifted by the core's stall so far, core): ties go to the lower core.
+  using Pending = std::pair<std::uint64_t, std::size_t>;
+  std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+  std::vector<std::size_t> cursor(n, 0);
+  std::vector<std::uint64_t> delay(n, 0);
+  for (std::size_t c = 0; c < n; ++c) {
+    if (!sorted[c].empty()) pending.push({sorted[c][0].issue, c});
+  }
+
+  std::uint64_t port_free = 0;
+  while (!pending.empty()) {
+    const auto [t, c] = pending.top();
+    pending.pop();
+    const DramTransfer& x = sorted[c][cursor[c]++];
+    const std::uint64_t start  = std::max(port_free, t);
+    const std::uint64_t finish = start + port->Cycles(x.ranges, x.write);
+    port_free = finish;
+    if (port_busy_cycles) *port_busy_cycles += finish - start;
+    // A late transfer stalls the core and everything it issues afterwards.
+    if (x.ready != DramTransfer::kNoDeadline && finish > x.ready + delay[c]) {
+      delay[c] = finish - x.ready;
+    }
+    if (cursor[c] < sorted[c].size()) {
+      pending.push({sorted[c][cursor[c]].issue + delay[c], c});
+    }
+  }
+  return delay;
+}
+
+} // namespace sf
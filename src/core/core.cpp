@@ -1,5 +1,25 @@
 // All comments are in English.
 #include "core/core.hpp"
+#include "arch/dram/simple_dram.hpp"  // input spine sizes (IsbSpineBytes_)
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace {
+std::uint64_t DrainCeilDiv(std::uint64_t num, std::uint64_t denom) {
+  return (num + denom - 1) / denom;
+}
+
+// Stores of a layer without a usable output region are timed in a scratch
+// region past the DRAM image: one slot of this size per core (store slot),
+// starting at the next aligned address after the image.
+constexpr std::uint64_t kScratchStoreAlign     = std::uint64_t{1} << 20;
+constexpr std::uint64_t kScratchStoreSlotBytes = std::uint64_t{64} << 20;
+
+std::once_flag g_scratch_store_warning;
+} // namespace
 
 namespace sf {
 
@@ -62,6 +82,8 @@ Core::Core(SimpleDRAM* dram,
       static_cast<std::uint64_t>(kNumPE) *
       static_cast<std::uint64_t>(TiledOutputBuffer::LocalFifoDepth()) *
       5 / 1024;
+  sram_stats_.tob_merge    = SelectNetworkCost(kNumPE, tob_.emit_width());
+  sram_stats_.sorter_merge = SelectNetworkCost(kTilesPerSpine, sorter_.width());
   ResetSramStats();
 }
 
@@ -88,6 +110,9 @@ void Core::PrepareForSpine(int h_out, int w_out)
   ClearTOB_Eachhw();
   ResetSignal_Eachhw();
   ComputeInputSpineBatches_Eachhw();
+  // A prefetch never crosses sites (the next site's batches differ).
+  isb_prefetch_.reset();
+  isb_.DiscardShadow();
 }
 
 void Core::UpdatehwOut_Eachhw(int h_out, int w_out)
@@ -143,18 +168,53 @@ void Core::ComputeInputSpineBatches_Eachhw()
 void Core::ResetCycleStats() {
   cycle_stats_ = {};
   cycle_ = 0;
+  first_weight_load_seen_   = false;
+  first_weight_load_cycles_ = 0;
+  weight_ready_cycle_ = 0;
+  pending_prefetch_tile_.reset();
+  isb_prefetch_.reset();
+  isb_tags_.Clear();
+  isb_shadow_tags_.Clear();
+  sorter_free_cycle_ = 0;
+  store_port_free_cycle_ = 0;
+  out_buffer_free_cycle_.fill(0);
+  next_out_buffer_ = 0;
+  store_busy_.clear();
   io_shadow_.ResetCredit();
+  dram_trace_.clear();
+  dram_timing_->Reset();
+  store_addr_ = 0;
+  pe_array_.ResetInvalidTaps();
   ResetSramStats();
 }
 
 CoreCycleStats Core::GetCycleStats() const {
-  return cycle_stats_;
+  CoreCycleStats stats = cycle_stats_;
+  stats.dram_row_hits   = dram_timing_->stats().row_hits;
+  stats.dram_row_misses = dram_timing_->stats().row_misses;
+  stats.invalid_taps    = pe_array_.invalid_taps();
+  return stats;
 }
 
 CoreSramStats Core::GetSramStats() const {
   return sram_stats_;
 }
 
+std::uint32_t Core::AdvanceFilterResidency(FilterBuffer::Residency& r, int tile_id,
+                                           WeightCachePolicy policy) const
+{
+  if (tile_id < 0 || tile_id >= total_tiles_) {
+    throw std::out_of_range("Core::AdvanceFilterResidency: tile_id out of range.");
+  }
+  return fb_.AdvanceResidency(r, static_cast<std::uint32_t>(total_tiles_),
+                              static_cast<std::uint32_t>(tile_id), policy);
+}
+
+void Core::RestoreFilterResidency(const FilterBuffer::Residency& r)
+{
+  fb_.RestoreResidency(r, static_cast<std::uint32_t>(layer_id_));
+}
+
 // ==================== Per-tile sequence ====================
 
 void Core::PrepareForTile(int tile_id)
@@ -164,14 +224,59 @@ void Core::PrepareForTile(int tile_id)
   ResetSignal_EachTile();
   {
     const std::uint32_t bytes = LoadWeightFromDram_EachTile(tile_id);
-    const std::uint64_t block = io_shadow_.ApplyLoadBytes(bytes);
-    cycle_stats_.load_cycles += block;
-    ConsumeBlockingCycles(block);
+    const std::uint32_t prefetch_bytes = fb_.last_prefetch_bytes();
+    if (bytes > prefetch_bytes) {
+      cycle_stats_.weight_reloads += 1;
+    } else {
+      cycle_stats_.weight_hits += 1;
+    }
+    if (prefetch_bytes > 0) cycle_stats_.weight_prefetches += 1;
+    cycle_stats_.weight_reload_bytes += bytes;
+    cycle_stats_.weight_evicted_bytes += fb_.last_evicted_bytes();
+    const std::uint64_t demand_cycles   = dram_timing_->Cycles(fb_.last_demand_ranges(), false);
+    const std::uint64_t prefetch_cycles = dram_timing_->Cycles(fb_.last_prefetch_ranges(), false);
+    if (!first_weight_load_seen_) {
+      first_weight_load_seen_   = true;
+      first_weight_load_cycles_ = demand_cycles + prefetch_cycles;
+    }
+    const bool pingpong = fb_.PingPongActive();
+    const std::uint64_t block =
+        pingpong ? PingPongWeightBlock_(tile_id, demand_cycles) : io_shadow_.ApplyLoadCycles(demand_cycles);
+    if (pingpong) {
+      TraceDram_(std::max(cycle_, weight_ready_cycle_), fb_.last_demand_ranges(), cycle_ + block);
+    } else {
+      // The load may start as soon as the compute that shadows it did.
+      dram_ranges_ = fb_.last_demand_ranges();
+      dram_ranges_.insert(dram_ranges_.end(), fb_.last_prefetch_ranges().begin(),
+                          fb_.last_prefetch_ranges().end());
+      TraceDram_(cycle_ - std::min(cycle_, io_shadow_.Credit()), dram_ranges_, cycle_ + block);
+    }
+    BlockOnLoad_(block);
+    if (pingpong) {
+      if (pending_prefetch_tile_ == static_cast<std::uint32_t>(tile_id)) {
+        pending_prefetch_tile_.reset();
+      }
+      if (prefetch_bytes > 0) {
+        // The next tile streams into the other half while this one computes.
+        weight_ready_cycle_    = cycle_ + prefetch_cycles;
+        pending_prefetch_tile_ = fb_.last_prefetch_tile();
+        TraceDram_(cycle_, fb_.last_prefetch_ranges(), DramTransfer::kNoDeadline);
+      }
+    }
     io_shadow_.ResetCredit();
   }
   LoadInputSpine_EachTile();
 }
 
+std::uint64_t Core::PingPongWeightBlock_(int tile_id, std::uint64_t demand_cycles) const
+{
+  const std::uint64_t busy = (weight_ready_cycle_ > cycle_) ? weight_ready_cycle_ - cycle_ : 0;
+  if (fb_.last_demand_bytes() > 0) {
+    return busy + demand_cycles;
+  }
+  return (pending_prefetch_tile_ == static_cast<std::uint32_t>(tile_id)) ? busy : 0;
+}
+
 void Core::ComputePEArrayOutID_EachTile(int tile_id)
 {
   if (total_tiles_ <= 0) {
@@ -221,15 +326,133 @@ void Core::LoadInputSpine_EachTile()
   if (current_inputspine_batches_.empty()) {
     throw std::runtime_error("Core::LoadInputSpine_EachTile: no batches for current (h,w).");
   }
-  isb_.PreloadFirstBatch(current_inputspine_batches_[0], layer_id_);
+  if (options_.stream_merge) {
+    LoadStream_(0);
+  } else {
+    isb_.PreloadFirstBatch(current_inputspine_batches_[0], layer_id_);
+  }
   {
-    const std::uint64_t bytes = isb_.LastLoadedBytes();
-    const std::uint64_t block = io_shadow_.ApplyLoadBytes(bytes);
-    cycle_stats_.load_cycles += block;
-    ConsumeBlockingCycles(block);
+    BlockOnLoad_(IsbLoadBlock_(0));
     io_shadow_.ResetCredit();
   }
   batch_cursor_ = 0;
+  IssueIsbPrefetch_();
+}
+
+std::uint64_t Core::IsbLoadBlock_(int b)
+{
+  const auto& ids = current_inputspine_batches_[static_cast<std::size_t>(b)];
+  if (options_.isb_shadow_bank && isb_prefetch_ && isb_prefetch_->ids == ids) {
+    // Swap in the shadow bank; its load was charged when the prefetch started.
+    std::swap(isb_tags_, isb_shadow_tags_);
+    const std::uint64_t ready = isb_prefetch_->issue_cycle + isb_prefetch_->cycles;
+    isb_prefetch_.reset();
+    return (ready > cycle_) ? ready - cycle_ : 0;
+  }
+  isb_prefetch_.reset();
+  std::uint64_t cycles = 0;
+  if (options_.isb_reuse) {
+    FetchIsbBatch_(isb_tags_, ids);
+    cycles = IsbLoadCycles_(isb_tags_.last_fetched());
+  } else {
+    cycles = IsbLoadCycles_(ids);
+  }
+  if (options_.isb_shadow_bank) {
+    TraceDram_(cycle_, dram_ranges_, cycle_ + cycles);
+    return cycles;
+  }
+  const std::uint64_t block = io_shadow_.ApplyLoadCycles(cycles);
+  TraceDram_(cycle_ - std::min(cycle_, io_shadow_.Credit()), dram_ranges_, cycle_ + block);
+  return block;
+}
+
+void Core::IssueIsbPrefetch_()
+{
+  if (!options_.isb_shadow_bank || total_batches_needed_ <= 0) {
+    return;
+  }
+  const int next = (batch_cursor_ + 1 < total_batches_needed_) ? batch_cursor_ + 1 : 0;
+  const auto& ids = current_inputspine_batches_[static_cast<std::size_t>(next)];
+  if (!options_.stream_merge) {
+    // The stream path replays merged batches from its cache instead.
+    isb_.PrefetchBatch(ids, layer_id_);
+  }
+  std::uint64_t bytes = 0;
+  std::uint64_t cycles = 0;
+  if (options_.isb_reuse) {
+    bytes = FetchIsbBatch_(isb_shadow_tags_, ids);
+    cycles = IsbLoadCycles_(isb_shadow_tags_.last_fetched());
+  } else {
+    for (const int id : ids) bytes += IsbSpineBytes_(id);
+    cycles = IsbLoadCycles_(ids);
+  }
+  isb_prefetch_ = IsbPrefetch{ids, cycle_, bytes, cycles};
+  TraceDram_(cycle_, dram_ranges_, DramTransfer::kNoDeadline);
+}
+
+dram::DramRange Core::IsbSpineRange_(int spine_id) const
+{
+  const auto* meta = dram_->layer_meta(static_cast<std::uint32_t>(layer_id_))
+                         .input_spines.Find(static_cast<std::uint32_t>(spine_id));
+  if (!meta) {
+    throw std::out_of_range("Core::IsbSpineRange_: input spine not found.");
+  }
+  const std::uint64_t cap = static_cast<std::uint64_t>(kIsbEntries) * sizeof(Entry);
+  return dram::DramRange{meta->addr, std::min<std::uint64_t>(meta->size, cap)};
+}
+
+std::uint64_t Core::IsbLoadCycles_(const std::vector<int>& ids)
+{
+  dram_ranges_.clear();
+  for (const int id : ids) dram_ranges_.push_back(IsbSpineRange_(id));
+  return dram_timing_->Cycles(dram_ranges_, false);
+}
+
+void Core::SetStoreSlot(int slot, int slots)
+{
+  if (slots < 1 || slot < 0 || slot >= slots) {
+    throw std::invalid_argument("Core::SetStoreSlot: slot must lie in [0, slots).");
+  }
+  store_slot_  = slot;
+  store_slots_ = slots;
+  store_addr_  = 0;
+}
+
+std::uint64_t Core::StoreCycles_(std::uint32_t bytes)
+{
+  // Output spines append to this core's share of the layer's output region
+  // (wrapping if the share is too small to hold the run). A region that
+  // cannot hold one store moves them to the scratch region past the image.
+  const auto& meta = dram_->layer_meta(static_cast<std::uint32_t>(layer_id_));
+  const std::uint64_t share =
+      (meta.output_region_end - meta.output_region_begin) / static_cast<std::uint64_t>(store_slots_);
+  std::uint64_t begin = meta.output_region_begin + static_cast<std::uint64_t>(store_slot_) * share;
+  std::uint64_t end   = begin + share;
+  if (share < bytes) {
+    const std::uint64_t scratch =
+        DrainCeilDiv(dram_->capacity(), kScratchStoreAlign) * kScratchStoreAlign;
+    std::call_once(g_scratch_store_warning, [&]() {
+      std::cerr << "[Core][Warn] L=" << layer_id_ << " has no output region for its stores"
+                << " (or a share smaller than one store); timing stores at 0x" << std::hex
+                << scratch << std::dec << " past the DRAM image, "
+                << (kScratchStoreSlotBytes >> 20) << " MiB per core.\n";
+    });
+    begin = scratch + static_cast<std::uint64_t>(store_slot_) * kScratchStoreSlotBytes;
+    end   = begin + kScratchStoreSlotBytes;
+  }
+  if (store_addr_ < begin || store_addr_ + bytes > end) {
+    store_addr_ = begin;
+  }
+  dram_ranges_.assign(1, dram::DramRange{store_addr_, bytes});
+  store_ranges_.push_back(dram_ranges_.front());
+  store_addr_ += bytes;
+  return dram_timing_->Cycles(dram_ranges_, true);
+}
+
+std::uint64_t Core::FetchIsbBatch_(IsbResidency& tags, const std::vector<int>& ids)
+{
+  return tags.Load(ids, [this](int id) { return IsbSpineBytes_(id); },
+                   sram_stats_.input_spine_dram_bytes_avoided);
 }
 
 void Core::Compute_EachTile(int tile_id)
@@ -244,31 +467,47 @@ void Core::Compute_EachTile(int tile_id)
     throw std::runtime_error("Core::ComputeTiles: first batch not preloaded; call LoadInputSpine_EachTile() first.");
   }
 
+  const std::uint64_t emitted_before = sram_stats_.output_queue.accesses;
   for (int b = batch_cursor_; b < total_batches_needed_; ++b) {
     // Run the compute loop for the current batch.
     const bool has_next = (b + 1 < total_batches_needed_);
     compute_finished_ = false;
     while (!compute_finished_) {
       StepOnce(tile_id);
+      if (options_.fast_forward) {
+        FastForwardStall(tile_id);
+      }
     }
     if (has_next) {
       const int next_b = b + 1;
-      const bool loaded = isb_.run(
-          current_inputspine_batches_[static_cast<std::size_t>(next_b)],
-          layer_id_,
-          next_b,
-          total_batches_needed_);
-      (void)loaded;
+      if (options_.stream_merge) {
+        LoadStream_(next_b);
+      } else {
+        const bool loaded = isb_.run(
+            current_inputspine_batches_[static_cast<std::size_t>(next_b)],
+            layer_id_,
+            next_b,
+            total_batches_needed_);
+        (void)loaded;
+      }
       // Apply compute credit from current batch to the load of the next batch.
-        const std::uint64_t bytes = isb_.LastLoadedBytes();
-        const std::uint64_t block = io_shadow_.ApplyLoadBytes(bytes);
-        cycle_stats_.load_cycles += block;
-        ConsumeBlockingCycles(block);
+        BlockOnLoad_(IsbLoadBlock_(next_b));
         io_shadow_.ResetCredit();
       
       batch_cursor_ = next_b;
+      IssueIsbPrefetch_();
     }
   }
+
+  // A wider TOB emit network is deeper: the tile's last entries leave it
+  // later (same pipeline fill as the output sorter, once per tile pass).
+  if (sram_stats_.output_queue.accesses > emitted_before) {
+    const std::uint64_t fill = SelectNetworkCost(kNumPE, tob_.emit_width()).depth -
+                               SelectNetworkCost(kNumPE, 1).depth;
+    io_shadow_.OnComputeCycle(fill);
+    cycle_ += fill;
+    cycle_stats_.compute_cycles += fill;
+  }
 }
 
 // ==================== StepOnce & Drain ====================
@@ -281,6 +520,7 @@ void Core::ResetSramStats() {
   sram_stats_.compute_load_bytes = 0;
   sram_stats_.compute_store_accesses = 0;
   sram_stats_.compute_store_bytes = 0;
+  sram_stats_.input_spine_dram_bytes_avoided = 0;
 }
 
 bool Core::StepOnce(int tile_id) {
@@ -292,34 +532,48 @@ bool Core::StepOnce(int tile_id) {
   // Stage 0 – TiledOutputBuffer
   // ---------------------------
   ran_tob_in_ = v_tob_in_ ? tob_.run(static_cast<std::size_t>(tile_id)) : false;
+  if (v_tob_in_ && tob_.stall_next_cycle()) {
+    cycle_stats_.tob_stall_cycles += 1;
+  }
+
+  // The PE array holds while the TOB has not taken all of its outputs (a
+  // new step would overwrite them).
+  const bool pe_ready = v_pe_ && !pe_array_.has_output_spikes();
+
+  if (options_.stream_merge) {
+    ran_pe_  = pe_ready ? StreamPE_()  : false;
+    ran_mfb_ = v_mfb_ ? StreamMFB_() : false;
+    FinishStep_(/*fifo_has=*/  stream_isb_pos_ > stream_gm_pos_,
+                /*isb_has=*/   stream_isb_pos_ < stream_->entries.size(),
+                /*fifo_space=*/!current_inputspine_batches_.empty() &&
+                               stream_isb_pos_ - stream_gm_pos_ < kInterFifoCapacityEntries);
+    return (ran_tob_in_ || ran_pe_ || ran_mfb_);
+  }
 
   // ---------------------------
   // Stage 1 – PEArray
   // ---------------------------
-  ran_pe_ = v_pe_ ? pe_array_.run(fb_) : false;
+  ran_pe_ = pe_ready ? pe_array_.run(fb_) : false;
 
   // ---------------------------
   // Stage 2 – MinFinderBatch
   // ---------------------------
-  ran_mfb_ = v_mfb_ ? mfb_.run(batch_cursor_, total_batches_needed_) : false;
+  ran_mfb_ = v_mfb_ ? RunMfb_() : false;
 
   // ---------------------------
   // NOTE: Stage 3 (ISB load of next batch) has been REMOVED from StepOnce.
   // Batch progression is now handled by ComputeTiles().
   // ---------------------------
 
+  FinishStep_(FifosHaveData(), !isb_.AllEmpty(), TargetFifoHasSpace());
+  return (ran_tob_in_ || ran_pe_ || ran_mfb_);
+}
+
+void Core::FinishStep_(bool fifo_has, bool isb_has, bool fifo_space) {
   // Compute next valids (hard backpressure + FIFO capacity for MFB).
   const bool stall = tob_.stall_next_cycle();  // replaces cooldown semantics
 
-  const auto& pe_slots = pe_array_.out_spike_entries();
-  bool pe_hasout = false;
-  for (const auto& s : pe_slots) {
-    if (s.has_value()) { pe_hasout = true; break; }
-  }
-
-  const bool fifo_has   = FifosHaveData();
-  const bool isb_has    = !isb_.AllEmpty();
-  const bool fifo_space = TargetFifoHasSpace();
+  const bool pe_hasout = pe_array_.has_output_spikes();
 
   // Allow TOB to run every cycle so it can drain its local per-PE FIFOs
   // even if the PEArray has no new outputs this cycle.
@@ -334,25 +588,31 @@ bool Core::StepOnce(int tile_id) {
   v_mfb_    = v_mfb_next;
 
   // Finish condition for compute of THIS batch for THIS tile.
-  // TOB will keep draining since v_tob_in_next is always true.
-  compute_finished_ = (!stall) && !fifo_has && !pe_hasout && !isb_has;
+  // TOB will keep draining since v_tob_in_next is always true; its local
+  // FIFOs must be empty too, or their spikes would land in the next tile
+  // (or be cleared with the site).
+  compute_finished_ = (!stall) && !fifo_has && !pe_hasout && !isb_has &&
+                      tob_.LocalFifosEmpty();
 
   // End-of-step: add the synchronous tick.
+  // Wide input moves several entries / weight rows per cycle.
   if (ran_mfb_) {
-    const std::uint64_t bytes = sizeof(Entry);
+    const std::uint64_t entries = mfb_moved_;
+    const std::uint64_t bytes = entries * sizeof(Entry);
     sram_stats_.input_spine.access_cycles += 1;
-    sram_stats_.input_spine.accesses += 1;
+    sram_stats_.input_spine.accesses += entries;
     sram_stats_.input_spine.bytes += bytes;
-    sram_stats_.compute_load_accesses += 1;
+    sram_stats_.compute_load_accesses += entries;
     sram_stats_.compute_load_bytes += bytes;
   }
 
   if (ran_pe_) {
-    const std::uint64_t bytes = static_cast<std::uint64_t>(kNumPE) * sizeof(std::int8_t);
+    const std::uint64_t rows = pe_array_.last_input_count();
+    const std::uint64_t bytes = rows * static_cast<std::uint64_t>(kNumPE) * sizeof(std::int8_t);
     sram_stats_.filter.access_cycles += 1;
-    sram_stats_.filter.accesses += 1;
+    sram_stats_.filter.accesses += rows;
     sram_stats_.filter.bytes += bytes;
-    sram_stats_.compute_load_accesses += 1;
+    sram_stats_.compute_load_accesses += rows;
     sram_stats_.compute_load_bytes += bytes;
   }
 
@@ -382,15 +642,209 @@ bool Core::StepOnce(int tile_id) {
   io_shadow_.OnComputeCycle(1);
   cycle_ += 1;
   cycle_stats_.compute_cycles += 1;
+}
 
-  return (ran_tob_in_ || ran_pe_ || ran_mfb_);
+std::uint64_t Core::LoadStream_(int b) {
+  // Every tile of a site loads the same batch list, so the merged stream (and
+  // the row id of each entry, which only depends on the site) is kept until
+  // the site or its batch list changes.
+  if (stream_cache_h_ != h_out_cur_ || stream_cache_w_ != w_out_cur_ ||
+      stream_cache_batches_ != current_inputspine_batches_) {
+    stream_cache_.clear();
+    stream_cache_batches_ = current_inputspine_batches_;
+    stream_cache_h_ = h_out_cur_;
+    stream_cache_w_ = w_out_cur_;
+  }
+
+  const std::size_t idx = static_cast<std::size_t>(b);
+  if (idx == stream_cache_.size()) {
+    const auto& ids = current_inputspine_batches_[idx];
+    if (b == 0) {
+      isb_.PreloadFirstBatch(ids, layer_id_);
+    } else {
+      isb_.run(ids, layer_id_, b, total_batches_needed_);
+    }
+    MergedBatch merged;
+    merged.loaded_bytes = isb_.LastLoadedBytes();
+    isb_.MergeInto(merged.entries);
+    merged.row_ids.reserve(merged.entries.size());
+    for (const Entry& e : merged.entries) {
+      merged.row_ids.push_back(fb_.ComputeRowId(e.neuron_id));
+    }
+    stream_cache_.push_back(std::move(merged));
+  } else if (idx > stream_cache_.size()) {
+    throw std::logic_error("Core::LoadStream_: batches must be loaded in order.");
+  }
+
+  stream_ = &stream_cache_[idx];
+  stream_isb_pos_ = 0;
+  stream_gm_pos_  = 0;
+  // A cached batch is still modeled as an ISB reload from DRAM.
+  return stream_->loaded_bytes;
 }
-void Core::DrainAllTilesAndStore(int & drained_entries) {
-  constexpr std::uint64_t kDrainBytesPerCycle = 160;
 
-  auto ceil_div = [](std::uint64_t num, std::uint64_t denom) -> std::uint64_t {
-    return (num + denom - 1) / denom;
+bool Core::StreamPE_() {
+  // GlobalMerger: only one FIFO (the current batch) can hold entries, so the
+  // smallest head is simply the oldest stream entry not yet consumed.
+  if (!mfb_.CanGlobalMegerWork() || stream_gm_pos_ == stream_isb_pos_) {
+    return false;
+  }
+  // Wide input: the following FIFO entries of the same timestamp.
+  const std::size_t begin = stream_gm_pos_;
+  const std::uint8_t ts = stream_->entries[begin].ts;
+  std::size_t end = begin + 1;
+  while (end < stream_isb_pos_ && end - begin < options_.input_width &&
+         stream_->entries[end].ts == ts) {
+    ++end;
+  }
+  pe_array_.RunEntries(&stream_->entries[begin], &stream_->row_ids[begin], end - begin, fb_);
+  stream_gm_pos_ = end;
+  return true;
+}
+
+bool Core::StreamMFB_() {
+  if (stream_isb_pos_ == stream_->entries.size()) {
+    return false;
+  }
+  if (batch_cursor_ < 0 || static_cast<std::size_t>(batch_cursor_) >= kNumIntermediateFifos) {
+    throw std::runtime_error("Core::StreamMFB_: current_batch_cursor out of range.");
+  }
+  // v_mfb_ was raised with FIFO space and only GM pops in between.
+  if (stream_isb_pos_ - stream_gm_pos_ >= kInterFifoCapacityEntries) {
+    throw std::logic_error("Core::StreamMFB_: target FIFO full while MFB is valid.");
+  }
+  mfb_moved_ = 0;
+  do {
+    ++stream_isb_pos_;
+    ++mfb_moved_;
+    mfb_.OnEntryPushed(batch_cursor_, total_batches_needed_);
+  } while (mfb_moved_ < options_.input_width &&
+           stream_isb_pos_ < stream_->entries.size() &&
+           stream_isb_pos_ - stream_gm_pos_ < kInterFifoCapacityEntries);
+  return true;
+}
+
+bool Core::RunMfb_() {
+  // Up to input_width entries per cycle, while the target FIFO has room.
+  mfb_moved_ = 0;
+  while (mfb_moved_ < options_.input_width &&
+         (mfb_moved_ == 0 || TargetFifoHasSpace()) &&
+         mfb_.run(batch_cursor_, total_batches_needed_)) {
+    ++mfb_moved_;
+  }
+  return mfb_moved_ > 0;
+}
+std::uint64_t Core::FastForwardStall(int tile_id) {
+  // While the TOB stalls, PE and MFB are gated off for the next cycle, so the
+  // pipeline reduces to "emit the smallest FIFO head" until no FIFO is full.
+  // Only enter once those valids are already down (they were computed before
+  // the stall became visible in the cycle that raised it).
+  if (v_pe_ || v_mfb_ || compute_finished_) {
+    return 0;
+  }
+
+  if (options_.validate_fast_forward) {
+    return ValidateFastForward_(tile_id);
+  }
+  return FastForward_(tile_id);
+}
+
+std::uint64_t Core::FastForward_(int tile_id) {
+  const std::uint64_t cycles = tob_.DrainWhileStalled(tile_id);
+  if (cycles == 0) {
+    return 0;
+  }
+
+  // Same per-cycle accounting as StepOnce: only the TOB ran, emitting (and
+  // asserting stall) every cycle.
+  ran_tob_in_ = true;
+  ran_pe_     = false;
+  ran_mfb_    = false;
+  const std::uint64_t emitted = tob_.last_drain_emitted_entries();
+  sram_stats_.output_queue.accesses      += emitted;
+  sram_stats_.output_queue.bytes         += emitted * sizeof(Entry);
+  sram_stats_.output_queue.access_cycles += cycles;
+  cycle_stats_.tob_stall_cycles += cycles;
+
+  io_shadow_.OnComputeCycle(cycles);
+  cycle_ += cycles;
+  cycle_stats_.compute_cycles += cycles;
+  return cycles;
+}
+
+std::uint64_t Core::ValidateFastForward_(int tile_id) {
+  // Everything a stall stretch advances outside the TOB.
+  struct Snapshot {
+    std::uint64_t cycle;
+    CoreCycleStats cycle_stats;
+    CoreSramStats sram_stats;
+    IOShadow io_shadow;
+    bool v_tob_in, v_pe, v_mfb, compute_finished, ran_tob_in, ran_pe, ran_mfb;
+  };
+  auto save = [this]() {
+    return Snapshot{cycle_, cycle_stats_, sram_stats_, io_shadow_,
+                    v_tob_in_, v_pe_, v_mfb_, compute_finished_, ran_tob_in_, ran_pe_, ran_mfb_};
+  };
+
+  // Reference: run the stretch one StepOnce per cycle on this core (the
+  // subsystems are wired to each other, so a Core copy cannot step on its
+  // own), then rewind and fast-forward the same stretch.
+  const Snapshot entry = save();
+  TiledOutputBuffer entry_tob = tob_;
+  std::uint64_t ref_cycles = 0;
+  while (tob_.AnyLocalFifoFull()) {
+    StepOnce(tile_id);
+    ++ref_cycles;
+  }
+  const Snapshot stepped = save();
+
+  cycle_ = entry.cycle;
+  cycle_stats_ = entry.cycle_stats;
+  sram_stats_ = entry.sram_stats;
+  io_shadow_ = entry.io_shadow;
+  v_tob_in_ = entry.v_tob_in;
+  v_pe_ = entry.v_pe;
+  v_mfb_ = entry.v_mfb;
+  compute_finished_ = entry.compute_finished;
+  ran_tob_in_ = entry.ran_tob_in;
+  ran_pe_ = entry.ran_pe;
+  ran_mfb_ = entry.ran_mfb;
+  tob_.RestoreState(entry_tob.TakeState());
+  const std::uint64_t cycles = FastForward_(tile_id);
+
+  auto check = [](const char* what, std::uint64_t fast, std::uint64_t slow) {
+    if (fast != slow) {
+      throw std::logic_error(std::string("Core::FastForwardStall: ") + what + " is " +
+                             std::to_string(fast) + " fast-forwarded but " +
+                             std::to_string(slow) + " per cycle.");
+    }
   };
+  const auto& oq = sram_stats_.output_queue;
+  const auto& ref_oq = stepped.sram_stats.output_queue;
+  check("stretch length", cycles, ref_cycles);
+  check("cycle", cycle_, stepped.cycle);
+  check("compute_cycles", cycle_stats_.compute_cycles, stepped.cycle_stats.compute_cycles);
+  check("tob_stall_cycles", cycle_stats_.tob_stall_cycles, stepped.cycle_stats.tob_stall_cycles);
+  check("IOShadow credit", io_shadow_.Credit(), stepped.io_shadow.Credit());
+  check("output_queue.accesses", oq.accesses, ref_oq.accesses);
+  check("output_queue.bytes", oq.bytes, ref_oq.bytes);
+  check("output_queue.access_cycles", oq.access_cycles, ref_oq.access_cycles);
+  check("compute_store_accesses", sram_stats_.compute_store_accesses,
+        stepped.sram_stats.compute_store_accesses);
+  const bool valids_match =
+      v_tob_in_ == stepped.v_tob_in && v_pe_ == stepped.v_pe && v_mfb_ == stepped.v_mfb &&
+      compute_finished_ == stepped.compute_finished && ran_tob_in_ == stepped.ran_tob_in &&
+      ran_pe_ == stepped.ran_pe && ran_mfb_ == stepped.ran_mfb;
+  if (!valids_match) {
+    throw std::logic_error("Core::FastForwardStall: pipeline valids differ from the per-cycle stretch.");
+  }
+  return cycles;
+}
+
+void Core::DrainAllTilesAndStore(int & drained_entries) {
+  auto& chunks = store_chunks_;
+  chunks.clear();
+  store_ranges_.clear();
 
   std::uint64_t sort_cycles = 0;
   std::uint64_t dram_cycles = 0;
@@ -404,17 +858,20 @@ void Core::DrainAllTilesAndStore(int & drained_entries) {
       if (bytes == 0) {
         break;
       }
-      dram_cycles += ceil_div(bytes, kDrainBytesPerCycle);
+      const std::uint64_t cycles = StoreCycles_(bytes);
+      dram_cycles += cycles;
       drained_this_call += bytes / sizeof(Entry);
+      chunks.push_back({bytes, cycles});
       continue;
     }
 
-    if (!sorter_.Sort()) {
+    const std::size_t sorted = sorter_.SortCycle();
+    if (sorted == 0) {
       break;
     }
 
     ++sort_cycles;
-    ++sorted_entries;
+    sorted_entries += sorted;
   }
   while (!out_spine_.empty()) {
     const std::uint32_t bytes =
@@ -422,8 +879,10 @@ void Core::DrainAllTilesAndStore(int & drained_entries) {
     if (bytes == 0) {
       break;
     }
-    dram_cycles += ceil_div(bytes, kDrainBytesPerCycle);
+    const std::uint64_t cycles = StoreCycles_(bytes);
+    dram_cycles += cycles;
     drained_this_call += bytes / sizeof(Entry);
+    chunks.push_back({bytes, cycles});
   }
 
   if (sorted_entries != drained_this_call) {
@@ -432,11 +891,96 @@ void Core::DrainAllTilesAndStore(int & drained_entries) {
   }
 
   drained_entries += static_cast<int>(drained_this_call);
+  // A wider sorter's merge network is deeper: extra pipeline fill per drain.
+  if (sort_cycles > 0) {
+    sort_cycles += SelectNetworkCost(kTilesPerSpine, sorter_.width()).depth -
+                   SelectNetworkCost(kTilesPerSpine, 1).depth;
+  }
+  cycle_stats_.sort_cycles += sort_cycles;
+  if (options_.overlap_store) {
+    ScheduleOverlappedStore_(chunks);
+    return;
+  }
   const std::uint64_t store_cycles = sort_cycles + dram_cycles;
   cycle_stats_.store_cycles += store_cycles;
+  TraceDram_(cycle_, store_ranges_, cycle_ + store_cycles, /*write=*/true);
   ConsumeBlockingCycles(store_cycles);
 }
 
+void Core::ScheduleOverlappedStore_(const std::vector<std::pair<std::uint32_t, std::uint64_t>>& chunks) {
+  // The TOB is handed to the sorter once it finished the previous site.
+  if (sorter_free_cycle_ > cycle_) {
+    const std::uint64_t wait = sorter_free_cycle_ - cycle_;
+    cycle_stats_.store_cycles += wait;
+    ConsumeBlockingCycles(wait);
+  }
+  // The sorter fills the two output-spine buffers alternately (width entries
+  // per cycle); a full buffer is stored once the DRAM port is free and can be
+  // refilled after its store completes.
+  const std::uint64_t width = sorter_.width();
+  std::uint64_t t = cycle_;
+  if (!chunks.empty()) {
+    t += SelectNetworkCost(kTilesPerSpine, width).depth - SelectNetworkCost(kTilesPerSpine, 1).depth;
+  }
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    const auto& [bytes, cycles] = chunks[i];
+    std::uint64_t& buffer_free = out_buffer_free_cycle_[next_out_buffer_];
+    next_out_buffer_ ^= 1;
+    const std::uint64_t sort_end =
+        std::max(t, buffer_free) + DrainCeilDiv(bytes / sizeof(Entry), width);
+    const std::uint64_t store_start = std::max(sort_end, store_port_free_cycle_);
+    const std::uint64_t store_end = store_start + cycles;
+    buffer_free = store_end;
+    store_port_free_cycle_ = store_end;
+    store_busy_.push_back({store_start, store_end});
+    dram_ranges_.assign(1, store_ranges_[i]);
+    TraceDram_(store_start, dram_ranges_, DramTransfer::kNoDeadline, /*write=*/true);
+    t = sort_end;
+  }
+  sorter_free_cycle_ = t;
+}
+
+void Core::BlockOnLoad_(std::uint64_t block) {
+  cycle_stats_.load_cycles += block;
+  // Overlapped stores hold the DRAM port; a blocking load waits them out.
+  std::uint64_t stall = 0;
+  if (!store_busy_.empty()) {
+    const std::uint64_t end = cycle_ + block;
+    std::size_t done = 0;
+    while (done < store_busy_.size() && store_busy_[done].second <= cycle_) ++done;
+    store_busy_.erase(store_busy_.begin(), store_busy_.begin() + static_cast<std::ptrdiff_t>(done));
+    for (const auto& busy : store_busy_) {
+      const std::uint64_t lo = std::max(busy.first, cycle_);
+      const std::uint64_t hi = std::min(busy.second, end);
+      if (hi > lo) stall += hi - lo;
+    }
+  }
+  cycle_stats_.store_cycles += stall;
+  ConsumeBlockingCycles(block + stall);
+}
+
+void Core::TraceDram_(std::uint64_t issue, const std::vector<dram::DramRange>& ranges,
+                      std::uint64_t ready, bool write) {
+  if (!trace_dram_) {
+    return;
+  }
+  std::uint64_t bytes = 0;
+  for (const dram::DramRange& r : ranges) bytes += r.bytes;
+  if (bytes == 0) {
+    return;
+  }
+  dram_trace_.push_back(DramTransfer{issue, ready, bytes, write, ranges});
+}
+
+void Core::FlushOverlappedStores() {
+  if (store_port_free_cycle_ > cycle_) {
+    const std::uint64_t wait = store_port_free_cycle_ - cycle_;
+    cycle_stats_.store_cycles += wait;
+    ConsumeBlockingCycles(wait);
+  }
+  store_busy_.clear();
+}
+
 bool Core::FifosHaveData() const {
   for (std::size_t i = 0; i < kNumIntermediateFifos; ++i) {
     if (!fifos_[i].empty()) return true;
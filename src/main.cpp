@@ -4,14 +4,40 @@
 #include <vector>
 #include <exception>
 #include <iostream>
+#include <memory>
 
+#include "arch/dram/dram_timing.hpp"
 #include "runner/simulation.hpp"
 
 int main(int argc, char** argv) {
   // std::cout << "Entry size is " << sizeof(sf::Entry) << " bytes\n";
-  // Usage: ./sim <bin_path> <json_path>
+  // Usage: ./sim <bin_path> <json_path> [--site-threads=N] [--layer-threads=N]
+  //        [--fast-forward[=validate]] [--stream-merge]
+  //        [--dram-storage=mmap|copy] [--zero-copy-isb] [--isb-shadow] [--isb-reuse]
+  //        [--overlap-store] [--tob-emit-width=1|2|4|8] [--sort-width=1|2|4|8]
+  //        [--input-width=1|2|4|8]
+  //        [--vmem=float|int16|int32] [--dataflow=site-major|weight-stationary]
+  //        [--tile-order=ascending|serpentine]
+  //        [--weight-cache=clear-all|lru|belady|pingpong] [--pingpong-split=ROWS]
+  //        [--cores=M] [--core-partition=round-robin|spike-balanced|spatial]
+  //        [--chip-dram-bw=BYTES_PER_CYCLE]
+  //        [--dram-timing=flat|banked] [--dram-channels=N] [--dram-banks=N]
+  //        [--dram-row-bytes=N] [--dram-burst-bytes=N] [--dram-row-hit=CYCLES]
+  //        [--dram-row-miss=CYCLES] [--dram-txn-overhead=CYCLES]
   if (argc < 3) {
-    std::cerr << "Usage: " << argv[0] << " <dram_image.bin> <config.json>\n";
+    std::cerr << "Usage: " << argv[0] << " <dram_image.bin> <config.json> [--site-threads=N] [--layer-threads=N]"
+              << " [--fast-forward[=validate]] [--stream-merge]"
+              << " [--dram-storage=mmap|copy] [--zero-copy-isb] [--isb-shadow] [--isb-reuse]"
+              << " [--overlap-store] [--tob-emit-width=1|2|4|8] [--sort-width=1|2|4|8]"
+              << " [--input-width=1|2|4|8]"
+              << " [--vmem=float|int16|int32] [--dataflow=site-major|weight-stationary]"
+              << " [--tile-order=ascending|serpentine]"
+              << " [--weight-cache=clear-all|lru|belady|pingpong] [--pingpong-split=ROWS]"
+              << " [--cores=M] [--core-partition=round-robin|spike-balanced|spatial]"
+              << " [--chip-dram-bw=BYTES_PER_CYCLE]"
+              << " [--dram-timing=flat|banked] [--dram-channels=N] [--dram-banks=N]"
+              << " [--dram-row-bytes=N] [--dram-burst-bytes=N] [--dram-row-hit=CYCLES]"
+              << " [--dram-row-miss=CYCLES] [--dram-txn-overhead=CYCLES]\n";
     return 1;
   }
 
@@ -19,6 +45,134 @@ int main(int argc, char** argv) {
   const std::string json_path = argv[2];
 
   try {
+    sf::SimOptions options;
+    // Geometry and latencies of --dram-timing=banked.
+    bool banked_dram = false;
+    std::string banked_flag;  // first banked-only option given
+    sf::dram::BankedDramConfig banked;
+    for (int i = 3; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const std::string kSiteThreads  = "--site-threads=";
+      const std::string kLayerThreads = "--layer-threads=";
+      const std::string kPingPongSplit = "--pingpong-split=";
+      const std::string kTobEmitWidth = "--tob-emit-width=";
+      const std::string kSortWidth = "--sort-width=";
+      const std::string kInputWidth = "--input-width=";
+      const std::string kCores = "--cores=";
+      const std::string kChipDramBw = "--chip-dram-bw=";
+      const std::string kDramChannels = "--dram-channels=";
+      const std::string kDramBanks = "--dram-banks=";
+      const std::string kDramRowBytes = "--dram-row-bytes=";
+      const std::string kDramBurstBytes = "--dram-burst-bytes=";
+      const std::string kDramRowHit = "--dram-row-hit=";
+      const std::string kDramRowMiss = "--dram-row-miss=";
+      const std::string kDramTxnOverhead = "--dram-txn-overhead=";
+      // Value of a --dram-* banked timing parameter.
+      auto banked_arg = [&arg, &banked_flag](const std::string& prefix) {
+        if (banked_flag.empty()) banked_flag = arg;
+        return static_cast<std::uint32_t>(std::stoul(arg.substr(prefix.size())));
+      };
+      if (arg.rfind(kSiteThreads, 0) == 0) {
+        options.site_threads = std::stoi(arg.substr(kSiteThreads.size()));
+      } else if (arg.rfind(kLayerThreads, 0) == 0) {
+        options.layer_threads = std::stoi(arg.substr(kLayerThreads.size()));
+      } else if (arg == "--fast-forward") {
+        options.core.fast_forward = true;
+      } else if (arg == "--fast-forward=validate") {
+        options.core.fast_forward = true;
+        options.core.validate_fast_forward = true;
+      } else if (arg == "--stream-merge") {
+        options.core.stream_merge = true;
+      } else if (arg == "--zero-copy-isb") {
+        options.core.zero_copy_isb = true;
+      } else if (arg == "--isb-shadow") {
+        options.core.isb_shadow_bank = true;
+      } else if (arg == "--isb-reuse") {
+        options.core.isb_reuse = true;
+      } else if (arg == "--overlap-store") {
+        options.core.overlap_store = true;
+      } else if (arg.rfind(kTobEmitWidth, 0) == 0) {
+        options.core.tob_emit_width = std::stoul(arg.substr(kTobEmitWidth.size()));
+      } else if (arg.rfind(kInputWidth, 0) == 0) {
+        options.core.input_width = std::stoul(arg.substr(kInputWidth.size()));
+      } else if (arg.rfind(kSortWidth, 0) == 0) {
+        options.core.sort_width = std::stoul(arg.substr(kSortWidth.size()));
+      } else if (arg == "--vmem=float") {
+        options.core.vmem_mode = sf::VmemMode::kFloat;
+      } else if (arg == "--vmem=int16") {
+        options.core.vmem_mode = sf::VmemMode::kInt16;
+      } else if (arg == "--vmem=int32") {
+        options.core.vmem_mode = sf::VmemMode::kInt32;
+      } else if (arg == "--dataflow=site-major") {
+        options.conv_dataflow = sf::ConvDataflow::kSiteMajor;
+      } else if (arg == "--dataflow=weight-stationary") {
+        options.conv_dataflow = sf::ConvDataflow::kWeightStationary;
+      } else if (arg == "--tile-order=ascending") {
+        options.tile_order = sf::AscendingTileOrder();
+      } else if (arg == "--tile-order=serpentine") {
+        options.tile_order = sf::SerpentineTileOrder();
+      } else if (arg == "--weight-cache=clear-all") {
+        options.core.weight_cache = sf::WeightCachePolicy::kClearAll;
+      } else if (arg == "--weight-cache=lru") {
+        options.core.weight_cache = sf::WeightCachePolicy::kLru;
+      } else if (arg == "--weight-cache=belady") {
+        options.core.weight_cache = sf::WeightCachePolicy::kBelady;
+      } else if (arg == "--weight-cache=pingpong") {
+        options.core.weight_cache = sf::WeightCachePolicy::kPingPong;
+      } else if (arg.rfind(kPingPongSplit, 0) == 0) {
+        options.core.pingpong_split_rows =
+            static_cast<std::uint32_t>(std::stoul(arg.substr(kPingPongSplit.size())));
+      } else if (arg.rfind(kCores, 0) == 0) {
+        options.chip.cores = std::stoi(arg.substr(kCores.size()));
+        if (options.chip.cores < 1) {
+          throw std::invalid_argument("--cores must be at least 1: " + arg);
+        }
+      } else if (arg == "--core-partition=round-robin") {
+        options.chip.partition = sf::RoundRobinSites();
+      } else if (arg == "--core-partition=spike-balanced") {
+        options.chip.partition = sf::SpikeBalancedSites();
+      } else if (arg == "--core-partition=spatial") {
+        options.chip.partition = sf::SpatialBlockSites();
+      } else if (arg.rfind(kChipDramBw, 0) == 0) {
+        options.chip.dram_bytes_per_cycle = std::stod(arg.substr(kChipDramBw.size()));
+      } else if (arg == "--dram-timing=flat") {
+        banked_dram = false;
+      } else if (arg == "--dram-timing=banked") {
+        banked_dram = true;
+      } else if (arg.rfind(kDramChannels, 0) == 0) {
+        banked.channels = banked_arg(kDramChannels);
+      } else if (arg.rfind(kDramBanks, 0) == 0) {
+        banked.banks = banked_arg(kDramBanks);
+      } else if (arg.rfind(kDramRowBytes, 0) == 0) {
+        banked.row_bytes = banked_arg(kDramRowBytes);
+      } else if (arg.rfind(kDramBurstBytes, 0) == 0) {
+        banked.burst_bytes = banked_arg(kDramBurstBytes);
+      } else if (arg.rfind(kDramRowHit, 0) == 0) {
+        banked.row_hit_cycles = banked_arg(kDramRowHit);
+      } else if (arg.rfind(kDramRowMiss, 0) == 0) {
+        banked.row_miss_cycles = banked_arg(kDramRowMiss);
+      } else if (arg.rfind(kDramTxnOverhead, 0) == 0) {
+        banked.transaction_overhead_cycles = banked_arg(kDramTxnOverhead);
+      } else if (arg == "--dram-storage=copy") {
+        options.dram_storage = sf::dram::SimpleDRAM::Storage::kCopy;
+      } else if (arg == "--dram-storage=mmap") {
+        options.dram_storage = sf::dram::SimpleDRAM::Storage::kMapped;
+      } else {
+        throw std::invalid_argument("unknown option: " + arg);
+      }
+    }
+    if (!banked_flag.empty() && !banked_dram) {
+      throw std::invalid_argument("option needs --dram-timing=banked: " + banked_flag);
+    }
+    if (banked_dram) {
+      // Channels split the flat model's bandwidth.
+      banked.channel_bytes_per_cycle = sf::kDefaultDramBytesPerCycle / banked.channels;
+      options.core.dram_timing = std::make_shared<sf::dram::BankedDramTiming>(banked);
+      // The chip's shared port: same banks, its channels split --chip-dram-bw.
+      banked.channel_bytes_per_cycle = options.chip.dram_bytes_per_cycle / banked.channels;
+      options.chip.dram_timing = std::make_shared<sf::dram::BankedDramTiming>(banked);
+    }
+
     // (1) Parse config → vector<LayerSpec>
     auto specs = sf::ParseConfig(json_path);
     namespace fs = std::filesystem;
@@ -36,10 +190,10 @@ int main(int argc, char** argv) {
     }
 
     // (2) Init DRAM (load bin + build per-layer metadata)
-    auto dram = sf::InitDram(bin_path, json_path);
+    auto dram = sf::InitDram(bin_path, json_path, options.dram_storage);
 
     // (3) Run all layers in order
-    sf::RunNetwork(specs, &dram, repo_name, model_name);
+    sf::RunNetwork(specs, &dram, repo_name, model_name, options);
 
     std::cout << "[Simulation] Completed successfully.\n";
     return 0;
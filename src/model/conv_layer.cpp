@@ -1,7 +1,10 @@
 // All comments are in English.
 #include "model/conv_layer.hpp"
 #include <algorithm>
+#include <exception>
 #include <iostream>
+#include <thread>
+#include <utility>
 
 namespace sf {
 
@@ -62,7 +65,58 @@ void ConvLayer::ConfigureLayer(int layer_id,
 
   // 5) Hold DRAM and construct Core (value-members architecture)
   dram_ = dram;
-  core_ = std::make_unique<Core>(
+  core_ = MakeCore_();
+}
+
+std::vector<std::uint32_t> ConvLayer::WeightRequestTrace_() const {
+  const int sites = H_out_ * W_out_;
+  std::vector<std::uint32_t> trace;
+  trace.reserve(static_cast<std::size_t>(sites) * static_cast<std::size_t>(total_tiles_));
+  if (dataflow_ == ConvDataflow::kWeightStationary) {
+    for (int tile_id = 0; tile_id < total_tiles_; ++tile_id) {
+      trace.insert(trace.end(), static_cast<std::size_t>(sites), static_cast<std::uint32_t>(tile_id));
+    }
+  } else {
+    std::vector<int> tiles;
+    for (int site = 0; site < sites; ++site) {
+      TileOrderFor_(site, tiles);
+      for (const int t : tiles) trace.push_back(static_cast<std::uint32_t>(t));
+    }
+  }
+  return trace;
+}
+
+std::vector<std::uint32_t> ConvLayer::SiteRequestTrace_(const std::vector<int>& sites) const {
+  std::vector<std::uint32_t> trace;
+  trace.reserve(sites.size() * static_cast<std::size_t>(total_tiles_));
+  std::vector<int> tiles;
+  for (const int site : sites) {
+    TileOrderFor_(site, tiles);
+    for (const int t : tiles) trace.push_back(static_cast<std::uint32_t>(t));
+  }
+  return trace;
+}
+
+std::vector<std::uint64_t> ConvLayer::SiteWork_() const {
+  const auto& spines = dram_->layer_meta(static_cast<std::uint32_t>(layer_id_)).input_spines;
+  std::vector<std::uint64_t> work(static_cast<std::size_t>(H_out_) * static_cast<std::size_t>(W_out_), 0);
+  for (int h = 0; h < H_out_; ++h) {
+    for (int w = 0; w < W_out_; ++w) {
+      std::uint64_t bytes = 0;
+      for (const auto& batch : batches_per_hw_.at(PackHW(h, w))) {
+        for (const int id : batch) {
+          const auto* meta = spines.Find(static_cast<std::uint32_t>(id));
+          if (meta) bytes += meta->size;
+        }
+      }
+      work[static_cast<std::size_t>(h * W_out_ + w)] = bytes / sizeof(Entry);
+    }
+  }
+  return work;
+}
+
+std::unique_ptr<Core> ConvLayer::MakeCore_() const {
+  auto core = std::make_unique<Core>(
               dram_,
               layer_id_, C_in_, C_out_,
               H_in_, W_in_,
@@ -75,6 +129,24 @@ void ConvLayer::ConfigureLayer(int layer_id,
               total_tiles_,
               &batches_per_hw_,
               batch_needed_);
+  core->SetOptions(core_options_);
+  if (core_options_.weight_cache == WeightCachePolicy::kBelady ||
+      core_options_.weight_cache == WeightCachePolicy::kPingPong) {
+    core->SetWeightRequestTrace(WeightRequestTrace_());
+  }
+  return core;
+}
+
+void ConvLayer::SetCoreOptions(const CoreOptions& options) {
+  core_options_ = options;
+  if (core_) core_->SetOptions(core_options_);
+}
+
+void ConvLayer::SetNumThreads(int num_threads) {
+  if (num_threads <= 0) {
+    throw std::invalid_argument("ConvLayer::SetNumThreads: num_threads must be positive.");
+  }
+  num_threads_ = num_threads;
 }
 
 std::vector<std::vector<int>> ConvLayer::generate_batches(int h_out, int w_out) const {
@@ -114,40 +186,262 @@ std::vector<std::vector<int>> ConvLayer::generate_batches(int h_out, int w_out)
   return batches;
 }
 
-// All comments are in English.
+TileOrderPolicy AscendingTileOrder() {
+  return [](int /*site*/, int total_tiles, std::vector<int>& order) {
+    order.resize(static_cast<std::size_t>(total_tiles));
+    for (int t = 0; t < total_tiles; ++t) order[static_cast<std::size_t>(t)] = t;
+  };
+}
+
+TileOrderPolicy SerpentineTileOrder() {
+  return [](int site, int total_tiles, std::vector<int>& order) {
+    order.resize(static_cast<std::size_t>(total_tiles));
+    for (int t = 0; t < total_tiles; ++t) {
+      order[static_cast<std::size_t>(t)] = (site % 2 == 0) ? t : total_tiles - 1 - t;
+    }
+  };
+}
+
+void ConvLayer::TileOrderFor_(int site, std::vector<int>& order) const {
+  const int total_tiles = total_tiles_;
+  if (!tile_order_) {
+    AscendingTileOrder()(site, total_tiles, order);
+    return;
+  }
+  order.clear();
+  tile_order_(site, total_tiles, order);
+  std::vector<bool> seen(static_cast<std::size_t>(total_tiles), false);
+  bool ok = (order.size() == static_cast<std::size_t>(total_tiles));
+  for (std::size_t i = 0; ok && i < order.size(); ++i) {
+    const int t = order[i];
+    ok = (t >= 0 && t < total_tiles && !seen[static_cast<std::size_t>(t)]);
+    if (ok) seen[static_cast<std::size_t>(t)] = true;
+  }
+  if (!ok) {
+    throw std::invalid_argument("ConvLayer::TileOrderFor_: tile order policy must return a permutation of the tiles.");
+  }
+}
+
+void ConvLayer::RunSite_(Core& core, int h, int w, const std::vector<int>& tiles,
+                         int& drained_entries) {
+  // Per-output-spine preparation.
+  core.PrepareForSpine(h, w);
+
+  // Iterate all tiles for this (h, w) in the site's order.
+  for (const int tile_id : tiles) {
+    // Per-tile preparation and compute across all batches.
+    core.PrepareForTile(tile_id);
+    core.Compute_EachTile(tile_id);
+  }
+
+  // Drain tile buffers into OutputSpine and store to DRAM.
+  core.DrainAllTilesAndStore(drained_entries);
+}
+
 void ConvLayer::run_layer() {
   if (!core_) {
     throw std::runtime_error("ConvLayer::run_layer: core not configured.");
   }
-  core_->ResetCycleStats();
   drained_entries_total_ = 0;
-  for (int h = 0; h < H_out_; ++h) {
-    for (int w = 0; w < W_out_; ++w) {
-      // Per-output-spine preparation.
-      core_->PrepareForSpine(h, w);
-
-      // Iterate all tiles for this (h, w).
-      const int total_tiles = core_->total_tiles();
-      for (int tile_id = 0; tile_id < total_tiles; ++tile_id) {
-        // Per-tile preparation and compute across all batches.
-        core_->PrepareForTile(tile_id);
-        core_->Compute_EachTile(tile_id);
+  if (core_options_.weight_cache == WeightCachePolicy::kBelady ||
+      core_options_.weight_cache == WeightCachePolicy::kPingPong) {
+    // The trace depends on dataflow_/tile_order_, which may have changed.
+    core_->SetWeightRequestTrace(WeightRequestTrace_());
+  }
+
+  // Weight bytes of the site-major ascending clear-all schedule from the same
+  // starting residency (bookkeeping replay only), for weight_bytes_saved().
+  std::uint64_t baseline_bytes = 0;
+  {
+    FilterBuffer::Residency r = core_->filter_residency();
+    for (int site = 0; site < H_out_ * W_out_; ++site) {
+      for (int tile_id = 0; tile_id < total_tiles_; ++tile_id) {
+        baseline_bytes += core_->AdvanceFilterResidency(r, tile_id, WeightCachePolicy::kClearAll);
       }
+    }
+  }
 
-      // Drain tile buffers into OutputSpine and store to DRAM.
-      
-      core_->DrainAllTilesAndStore(drained_entries_total_);
+  if (chip_options_.cores > 1) {
+    if (dataflow_ != ConvDataflow::kSiteMajor) {
+      throw std::invalid_argument("ConvLayer::run_layer: a multi-core chip needs the site-major dataflow.");
+    }
+    RunChip_();
+    weight_bytes_saved_ = static_cast<std::int64_t>(baseline_bytes) -
+                          static_cast<std::int64_t>(last_cycle_stats_.weight_reload_bytes);
+    return;
+  }
+  last_chip_stats_ = ChipStats{};
 
+  // The ping-pong load engine's timeline, ISB residency, overlapped stores
+  // and DRAM open rows cross sites, so those modes run serially.
+  const bool parallel = dataflow_ == ConvDataflow::kSiteMajor &&
+                        core_options_.weight_cache != WeightCachePolicy::kPingPong &&
+                        !core_options_.isb_reuse && !core_options_.overlap_store &&
+                        !core_options_.dram_timing &&
+                        num_threads_ > 1 && H_out_ * W_out_ > 1;
+  if (parallel) {
+    RunLayerParallel_();
+  } else {
+    core_->ResetCycleStats();
+    if (dataflow_ == ConvDataflow::kWeightStationary) {
+      RunWeightStationary_(*core_);
+    } else {
+      std::vector<int> tiles;
+      for (int h = 0; h < H_out_; ++h) {
+        for (int w = 0; w < W_out_; ++w) {
+          TileOrderFor_(h * W_out_ + w, tiles);
+          RunSite_(*core_, h, w, tiles, drained_entries_total_);
+        }
+      }
     }
+    core_->FlushOverlappedStores();
+    last_cycle_stats_ = core_->GetCycleStats();
+    last_sram_stats_ = core_->GetSramStats();
   }
-  last_cycle_stats_ = core_->GetCycleStats();
-  last_sram_stats_ = core_->GetSramStats();
+  weight_bytes_saved_ = static_cast<std::int64_t>(baseline_bytes) -
+                        static_cast<std::int64_t>(last_cycle_stats_.weight_reload_bytes);
+}
+
+void ConvLayer::RunWeightStationary_(Core& core) {
   const int sites = H_out_ * W_out_;
-  if (sites > 0) {
-    std::cout << "drained entries: " << drained_entries_total_ << "\n";
-  } else {
-    std::cout << "drained entries: " << drained_entries_total_ << "\n";
+  const int total_tiles = core.total_tiles();
+
+  // TOB contents of every site between tile passes (tile buffers filled so
+  // far plus local FIFO leftovers, which spill into the next tile as in the
+  // site-major order).
+  std::vector<TiledOutputBuffer::State> parked(
+      total_tiles > 1 ? static_cast<std::size_t>(sites) : 0);
+
+  for (int tile_id = 0; tile_id < total_tiles; ++tile_id) {
+    const bool last_pass = (tile_id + 1 == total_tiles);
+    for (int site = 0; site < sites; ++site) {
+      core.PrepareForSpine(site / W_out_, site % W_out_);
+      if (tile_id > 0) {
+        core.RestoreSiteOutput(std::move(parked[static_cast<std::size_t>(site)]));
+      }
+      core.PrepareForTile(tile_id);
+      core.Compute_EachTile(tile_id);
+      if (last_pass) {
+        core.DrainAllTilesAndStore(drained_entries_total_);
+      } else {
+        parked[static_cast<std::size_t>(site)] = core.TakeSiteOutput();
+      }
+    }
+  }
+}
+
+void ConvLayer::RunChip_() {
+  Chip chip(chip_options_);
+  const bool needs_trace = core_options_.weight_cache == WeightCachePolicy::kBelady ||
+                           core_options_.weight_cache == WeightCachePolicy::kPingPong;
+  chip.Run(H_out_, W_out_, SiteWork_(),
+           [&](const std::vector<int>& sites) {
+             std::unique_ptr<Core> core = MakeCore_();
+             if (needs_trace) core->SetWeightRequestTrace(SiteRequestTrace_(sites));
+             return core;
+           },
+           [&](Core& core, int site, int& drained_entries) {
+             std::vector<int> tiles;
+             TileOrderFor_(site, tiles);
+             RunSite_(core, site / W_out_, site % W_out_, tiles, drained_entries);
+           },
+           num_threads_);
+  last_chip_stats_  = chip.stats();
+  last_cycle_stats_ = chip.cycle_stats();
+  last_sram_stats_  = chip.sram_stats();
+  drained_entries_total_ = chip.drained_entries();
+}
+
+// Sites only interact through two pieces of Core state:
+//  - FilterBuffer residency: replayed up front (bookkeeping only) so every
+//    replica starts its shard with the tiles the serial run would hold;
+//  - IOShadow credit: the first weight load of a shard sees the compute credit
+//    left by the previous shard's last site. Replicas start with zero credit,
+//    so the merge subtracts the shadow they missed.
+// Everything else (ISB, FIFOs, TOB, PE membranes) is reset per site/tile.
+void ConvLayer::RunLayerParallel_() {
+  const int sites   = H_out_ * W_out_;
+  const int workers = std::min(num_threads_, sites);
+  // Contiguous shards in site order.
+  std::vector<int> shard_begin(static_cast<std::size_t>(workers) + 1, 0);
+  for (int i = 0; i <= workers; ++i) {
+    shard_begin[static_cast<std::size_t>(i)] =
+        static_cast<int>(static_cast<long long>(sites) * i / workers);
+  }
+
+  // FilterBuffer residency at the start of every shard.
+  std::vector<FilterBuffer::Residency> shard_residency(static_cast<std::size_t>(workers));
+  {
+    FilterBuffer::Residency r = core_->filter_residency();
+    std::vector<int> tiles;
+    for (int i = 0; i < workers; ++i) {
+      shard_residency[static_cast<std::size_t>(i)] = r;
+      for (int site = shard_begin[static_cast<std::size_t>(i)];
+           site < shard_begin[static_cast<std::size_t>(i) + 1]; ++site) {
+        TileOrderFor_(site, tiles);
+        for (const int tile_id : tiles) {
+          core_->AdvanceFilterResidency(r, tile_id);
+        }
+      }
+    }
+  }
+
+  struct ShardResult {
+    CoreCycleStats cycles{};
+    CoreSramStats  sram{};
+    int            drained_entries = 0;
+    std::uint64_t  first_load_cycles = 0;
+    std::uint64_t  tail_credit = 0;
+    std::exception_ptr error;
+  };
+  std::vector<ShardResult> results(static_cast<std::size_t>(workers));
+  std::vector<std::unique_ptr<Core>> replicas(static_cast<std::size_t>(workers));
+  for (auto& replica : replicas) replica = MakeCore_();
+
+  auto run_shard = [&](int i) {
+    ShardResult& res = results[static_cast<std::size_t>(i)];
+    try {
+      Core& core = *replicas[static_cast<std::size_t>(i)];
+      core.RestoreFilterResidency(shard_residency[static_cast<std::size_t>(i)]);
+      core.ResetCycleStats();
+      std::vector<int> tiles;
+      for (int site = shard_begin[static_cast<std::size_t>(i)];
+           site < shard_begin[static_cast<std::size_t>(i) + 1]; ++site) {
+        TileOrderFor_(site, tiles);
+        RunSite_(core, site / W_out_, site % W_out_, tiles, res.drained_entries);
+      }
+      res.cycles = core.GetCycleStats();
+      res.sram   = core.GetSramStats();
+      res.first_load_cycles = core.first_weight_load_cycles();
+      res.tail_credit       = core.io_credit();
+    } catch (...) {
+      res.error = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(static_cast<std::size_t>(workers) - 1);
+  for (int i = 1; i < workers; ++i) threads.emplace_back(run_shard, i);
+  run_shard(0);
+  for (auto& t : threads) t.join();
+
+  // Merge in site order.
+  CoreCycleStats cycles{};
+  CoreSramStats  sram{};
+  for (int i = 0; i < workers; ++i) {
+    const ShardResult& res = results[static_cast<std::size_t>(i)];
+    if (res.error) std::rethrow_exception(res.error);
+    CoreCycleStats shard_cycles = res.cycles;
+    if (i > 0) {
+      const std::uint64_t incoming = results[static_cast<std::size_t>(i) - 1].tail_credit;
+      shard_cycles.load_cycles -= std::min(res.first_load_cycles, incoming);
+    }
+    Accumulate(cycles, shard_cycles);
+    Accumulate(sram, res.sram);
+    drained_entries_total_ += res.drained_entries;
   }
+  last_cycle_stats_ = cycles;
+  last_sram_stats_  = sram;
 }
 
 
@@ -2,6 +2,7 @@
 #include "model/fc_layer.hpp"
 #include <algorithm>
 #include <iostream>
+#include <utility>
 
 namespace sf {
 
@@ -77,6 +78,12 @@ void FCLayer::ConfigureLayer(int layer_id,
               total_tiles_,
               &batches_per_hw_,
               batch_needed_);
+  core_->SetOptions(core_options_);
+}
+
+void FCLayer::SetCoreOptions(const CoreOptions& options) {
+  core_options_ = options;
+  if (core_) core_->SetOptions(core_options_);
 }
 
 std::vector<std::vector<int>> FCLayer::generate_batches(int /*h_out*/, int /*w_out*/) const {
@@ -117,6 +124,16 @@ void FCLayer::run_layer() {
   }
   core_->ResetCycleStats();
   drained_entries_total_ = 0;
+  if (core_options_.weight_cache == WeightCachePolicy::kBelady ||
+      core_options_.weight_cache == WeightCachePolicy::kPingPong) {
+    std::vector<std::uint32_t> trace;
+    for (int site = 0; site < H_out_ * W_out_; ++site) {
+      for (int tile_id = 0; tile_id < core_->total_tiles(); ++tile_id) {
+        trace.push_back(static_cast<std::uint32_t>(tile_id));
+      }
+    }
+    core_->SetWeightRequestTrace(std::move(trace));
+  }
   for (int h = 0; h < H_out_; ++h) {
     for (int w = 0; w < W_out_; ++w) {
       core_->PrepareForSpine(h, w);
@@ -130,6 +147,7 @@ void FCLayer::run_layer() {
       core_->DrainAllTilesAndStore(drained_entries_total_);
     }
   }
+  core_->FlushOverlappedStores();
   last_cycle_stats_ = core_->GetCycleStats();
   last_sram_stats_ = core_->GetSramStats();
 }
@@ -0,0 +1,253 @@
+// All comments are in English.
+#include "runner/meta_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "arch/dram/mapped_file.hpp"
+
+namespace sf {
+
+namespace {
+
+using sf::dram::LayerMeta;
+using sf::dram::MappedFile;
+using sf::dram::SpineMeta;
+using sf::dram::WeightTileMeta;
+
+std::uint64_t Align8(std::uint64_t n) { return (n + 7u) & ~std::uint64_t{7u}; }
+
+MetaIndexLayer ToRecord(const LayerSpec& s) {
+  MetaIndexLayer r{};
+  r.L = s.L;
+  r.kind = static_cast<std::int32_t>(s.kind);
+  r.Cin_in = s.Cin_in; r.H_in = s.H_in; r.W_in = s.W_in;
+  r.Cin_w = s.Cin_w; r.Cout = s.Cout; r.Kh = s.Kh; r.Kw = s.Kw;
+  r.Sh = s.Sh; r.Sw = s.Sw; r.Ph = s.Ph; r.Pw = s.Pw; r.Dh = s.Dh; r.Dw = s.Dw;
+  r.Cout_out = s.Cout_out; r.H_out = s.H_out; r.W_out = s.W_out;
+  r.threshold = s.threshold_;
+  r.w_bits = s.w_bits;
+  r.w_signed = s.w_signed ? 1 : 0;
+  r.w_frac_bits = s.w_frac_bits;
+  r.w_scale = s.w_scale;
+  r.w_float_min = s.w_float_min;
+  r.w_float_max = s.w_float_max;
+  r.flags = (s.has_w_qformat ? kMetaIndexHasQFormat : 0u) |
+            (s.has_w_scale   ? kMetaIndexHasScale   : 0u);
+  return r;
+}
+
+LayerSpec FromRecord(const MetaIndexLayer& r, std::string name) {
+  LayerSpec s;
+  s.L = r.L;
+  s.kind = static_cast<LayerKind>(r.kind);
+  s.Cin_in = r.Cin_in; s.H_in = r.H_in; s.W_in = r.W_in;
+  s.Cin_w = r.Cin_w; s.Cout = r.Cout; s.Kh = r.Kh; s.Kw = r.Kw;
+  s.Sh = r.Sh; s.Sw = r.Sw; s.Ph = r.Ph; s.Pw = r.Pw; s.Dh = r.Dh; s.Dw = r.Dw;
+  s.Cout_out = r.Cout_out; s.H_out = r.H_out; s.W_out = r.W_out;
+  s.threshold_ = r.threshold;
+  s.name = std::move(name);
+  s.w_bits = r.w_bits;
+  s.w_signed = (r.w_signed != 0);
+  s.w_frac_bits = r.w_frac_bits;
+  s.w_scale = r.w_scale;
+  s.w_float_min = r.w_float_min;
+  s.w_float_max = r.w_float_max;
+  s.has_w_qformat = (r.flags & kMetaIndexHasQFormat) != 0;
+  s.has_w_scale   = (r.flags & kMetaIndexHasScale) != 0;
+  return s;
+}
+
+// Largest id (exclusive) a slot array may cover: the dense range of IdTable.
+// Larger ids would make the array (and the file) huge, so they are rejected.
+constexpr std::uint64_t kMaxSlotIds = sf::dram::IdTable<SpineMeta>::kDenseLimit;
+
+// Dense slot array for an id-keyed table (holes stay present = 0).
+template <typename Table>
+std::vector<MetaIndexSlot> ToSlots(const Table& tbl, int layer, const char* what) {
+  std::uint64_t count = 0;
+  tbl.ForEach([&count](std::uint32_t id, const auto&) {
+    count = std::max(count, std::uint64_t{id} + 1u);
+  });
+  if (count > kMaxSlotIds) {
+    throw std::invalid_argument("WriteMetaIndex: layer " + std::to_string(layer) + " " + what +
+                                " id " + std::to_string(count - 1) + " exceeds the index limit of " +
+                                std::to_string(kMaxSlotIds - 1) + ".");
+  }
+  std::vector<MetaIndexSlot> slots(static_cast<std::size_t>(count), MetaIndexSlot{0, 0, 0});
+  tbl.ForEach([&slots](std::uint32_t id, const auto& m) {
+    slots[id] = MetaIndexSlot{m.addr, m.size, 1};
+  });
+  return slots;
+}
+
+// Read-only view over a mapped index; every offset is bounds-checked once.
+class MetaIndexView {
+public:
+  explicit MetaIndexView(const std::string& path)
+    : file_(MappedFile::Open(path, MappedFile::Mode::kReadOnly)) {
+    if (file_.size() < sizeof(MetaIndexHeader)) {
+      throw std::runtime_error("MetaIndex: file too small: " + path);
+    }
+    std::memcpy(&header_, file_.data(), sizeof(header_));
+    if (std::memcmp(header_.magic, kMetaIndexMagic, sizeof(kMetaIndexMagic)) != 0) {
+      throw std::runtime_error("MetaIndex: bad magic: " + path);
+    }
+    if (header_.byte_order != kMetaIndexByteOrder) {
+      throw std::runtime_error("MetaIndex: byte order mismatch: " + path);
+    }
+    if (header_.version != kMetaIndexVersion) {
+      throw std::runtime_error("MetaIndex: unsupported version " + std::to_string(header_.version) +
+                               " (expected " + std::to_string(kMetaIndexVersion) + "): " + path);
+    }
+    if (header_.file_size != file_.size()) {
+      throw std::runtime_error("MetaIndex: truncated file: " + path);
+    }
+    Check_(header_.layers_offset, std::uint64_t{header_.num_layers} * sizeof(MetaIndexLayer), path);
+    Check_(header_.strings_offset, header_.strings_size, path);
+    for (std::uint32_t i = 0; i < header_.num_layers; ++i) {
+      const MetaIndexLayer& r = layer(i);
+      if (std::uint64_t{r.name_offset} + r.name_size > header_.strings_size) {
+        throw std::runtime_error("MetaIndex: layer name out of range: " + path);
+      }
+      Check_(r.input_spines_offset, std::uint64_t{r.num_input_spines} * sizeof(MetaIndexSlot), path);
+      Check_(r.weight_tiles_offset, std::uint64_t{r.num_weight_tiles} * sizeof(MetaIndexSlot), path);
+    }
+  }
+
+  std::uint32_t num_layers() const { return header_.num_layers; }
+
+  const MetaIndexLayer& layer(std::uint32_t i) const {
+    return reinterpret_cast<const MetaIndexLayer*>(file_.data() + header_.layers_offset)[i];
+  }
+  std::string name(const MetaIndexLayer& r) const {
+    const char* p = reinterpret_cast<const char*>(file_.data() + header_.strings_offset + r.name_offset);
+    return std::string(p, r.name_size);
+  }
+  const MetaIndexSlot* slots(std::uint64_t offset) const {
+    return reinterpret_cast<const MetaIndexSlot*>(file_.data() + offset);
+  }
+
+private:
+  void Check_(std::uint64_t offset, std::uint64_t bytes, const std::string& path) const {
+    if (offset > file_.size() || bytes > file_.size() - offset || (offset % 8) != 0) {
+      throw std::runtime_error("MetaIndex: section out of range: " + path);
+    }
+  }
+
+  MappedFile      file_;
+  MetaIndexHeader header_{};
+};
+
+} // namespace
+
+bool IsMetaIndexFile(const std::string& path) {
+  std::ifstream ifs(path, std::ios::binary);
+  char magic[sizeof(kMetaIndexMagic)] = {};
+  if (!ifs.read(magic, sizeof(magic))) return false;
+  return std::memcmp(magic, kMetaIndexMagic, sizeof(magic)) == 0;
+}
+
+void WriteMetaIndex(const std::string& json_path, const std::string& index_path) {
+  const std::vector<LayerSpec> specs = ParseConfig(json_path);
+
+  std::ifstream ifs(json_path);
+  if (!ifs) throw std::runtime_error("WriteMetaIndex: cannot open json file: " + json_path);
+  const std::string jtxt((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  sf::dram::SimpleDRAM tables(0);
+  tables.BuildFromJson(jtxt);
+
+  // Lay out sections.
+  MetaIndexHeader h{};
+  std::memcpy(h.magic, kMetaIndexMagic, sizeof(kMetaIndexMagic));
+  h.version    = kMetaIndexVersion;
+  h.byte_order = kMetaIndexByteOrder;
+  h.num_layers = static_cast<std::uint32_t>(specs.size());
+  h.layers_offset = sizeof(MetaIndexHeader);
+
+  std::vector<MetaIndexLayer> records;
+  std::string strings;
+  std::vector<std::vector<MetaIndexSlot>> spine_slots, tile_slots;
+  for (const LayerSpec& s : specs) {
+    const LayerMeta& meta = tables.layer_meta(static_cast<std::uint32_t>(s.L));
+    MetaIndexLayer r = ToRecord(s);
+    r.name_offset = static_cast<std::uint32_t>(strings.size());
+    r.name_size   = static_cast<std::uint32_t>(s.name.size());
+    strings += s.name;
+    r.output_region_begin = meta.output_region_begin;
+    r.output_region_end   = meta.output_region_end;
+    r.output_write_ptr    = meta.output_write_ptr;
+    spine_slots.push_back(ToSlots(meta.input_spines, s.L, "input spine"));
+    tile_slots.push_back(ToSlots(meta.weight_tiles, s.L, "weight tile"));
+    r.num_input_spines = static_cast<std::uint32_t>(spine_slots.back().size());
+    r.num_weight_tiles = static_cast<std::uint32_t>(tile_slots.back().size());
+    records.push_back(r);
+  }
+  h.strings_offset = h.layers_offset + records.size() * sizeof(MetaIndexLayer);
+  h.strings_size   = strings.size();
+  strings.resize(static_cast<std::size_t>(Align8(strings.size())), '\0');
+
+  std::uint64_t offset = h.strings_offset + strings.size();
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    records[i].input_spines_offset = offset;
+    offset += spine_slots[i].size() * sizeof(MetaIndexSlot);
+    records[i].weight_tiles_offset = offset;
+    offset += tile_slots[i].size() * sizeof(MetaIndexSlot);
+  }
+  h.file_size = offset;
+
+  std::ofstream ofs(index_path, std::ios::binary | std::ios::trunc);
+  if (!ofs) throw std::runtime_error("WriteMetaIndex: cannot open output file: " + index_path);
+  auto put = [&ofs](const void* p, std::size_t n) {
+    ofs.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+  };
+  put(&h, sizeof(h));
+  put(records.data(), records.size() * sizeof(MetaIndexLayer));
+  put(strings.data(), strings.size());
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    put(spine_slots[i].data(), spine_slots[i].size() * sizeof(MetaIndexSlot));
+    put(tile_slots[i].data(), tile_slots[i].size() * sizeof(MetaIndexSlot));
+  }
+  if (!ofs) throw std::runtime_error("WriteMetaIndex: write failed: " + index_path);
+}
+
+std::vector<LayerSpec> ParseMetaIndex(const std::string& index_path) {
+  const MetaIndexView view(index_path);
+  std::vector<LayerSpec> out;
+  out.reserve(view.num_layers());
+  for (std::uint32_t i = 0; i < view.num_layers(); ++i) {
+    const MetaIndexLayer& r = view.layer(i);
+    out.push_back(FromRecord(r, view.name(r)));
+  }
+  // The converter writes layers in ParseConfig order (ascending L).
+  return out;
+}
+
+void BuildDramFromMetaIndex(const std::string& index_path, sf::dram::SimpleDRAM& dram) {
+  const MetaIndexView view(index_path);
+  for (std::uint32_t i = 0; i < view.num_layers(); ++i) {
+    const MetaIndexLayer& r = view.layer(i);
+    LayerMeta meta;
+    const MetaIndexSlot* spines = view.slots(r.input_spines_offset);
+    meta.input_spines.Reserve(r.num_input_spines);
+    for (std::uint32_t id = 0; id < r.num_input_spines; ++id) {
+      if (spines[id].present) meta.input_spines.Insert(id, SpineMeta{id, spines[id].addr, spines[id].size});
+    }
+    const MetaIndexSlot* tiles = view.slots(r.weight_tiles_offset);
+    meta.weight_tiles.Reserve(r.num_weight_tiles);
+    for (std::uint32_t id = 0; id < r.num_weight_tiles; ++id) {
+      if (tiles[id].present) meta.weight_tiles.Insert(id, WeightTileMeta{id, tiles[id].addr, tiles[id].size});
+    }
+    meta.output_region_begin = r.output_region_begin;
+    meta.output_region_end   = r.output_region_end;
+    meta.output_write_ptr    = r.output_write_ptr;
+    dram.SetLayerMeta(static_cast<std::uint32_t>(r.L), std::move(meta));
+  }
+}
+
+} // namespace sf
@@ -1,5 +1,6 @@
 // All comments are in English.
 #include "runner/simulation.hpp"
+#include "runner/meta_index.hpp"
 #include <fstream>
 #include <iterator>
 #include <algorithm>
@@ -7,6 +8,9 @@
 #include <filesystem>
 #include <cctype>
 #include <iomanip>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 using nlohmann::json;
 
@@ -20,6 +24,9 @@ struct LayerStageRecord {
   LayerKind kind = LayerKind::kConv;
   CoreCycleStats cycles{};
   CoreSramStats sram_stats{};
+  int drained_entries = 0;
+  std::int64_t weight_bytes_saved = 0;  // ConvLayer::weight_bytes_saved
+  ChipStats chip{};                      // ConvLayer::chip_stats
 };
 
 std::string SanitizeName(const std::string& input) {
@@ -67,6 +74,16 @@ std::filesystem::path BuildSramCapacityCsvPath(const std::string& repo_name,
   return dir / file;
 }
 
+std::filesystem::path BuildChipCsvPath(const std::string& repo_name,
+                                       const std::string& model_name) {
+  const auto sanitized_repo  = SanitizeName(repo_name);
+  const auto sanitized_model = SanitizeName(model_name);
+  std::filesystem::path dir("stats");
+  std::filesystem::path file =
+      sanitized_repo + "__" + sanitized_model + "__chip_cores.csv";
+  return dir / file;
+}
+
 std::filesystem::path BuildStageCsvPath(const std::string& repo_name,
                                         const std::string& model_name) {
   const auto sanitized_repo  = SanitizeName(repo_name);
@@ -87,7 +104,10 @@ void WriteStageCyclesCsv(const std::string& repo_name,
     throw std::runtime_error("RunNetwork: failed to open stage cycles CSV file " + csv_path.string());
   }
 
-  ofs << "repo,model,layer_id,layer_name,layer_kind,load_cycles,compute_cycles,store_cycles\n";
+  ofs << "repo,model,layer_id,layer_name,layer_kind,load_cycles,compute_cycles,store_cycles,"
+         "weight_reloads,weight_reload_bytes,weight_bytes_saved,"
+         "weight_hits,weight_evicted_bytes,tob_stall_cycles,sort_cycles,"
+         "dram_row_hits,dram_row_misses,invalid_taps,weight_prefetches\n";
   for (const auto& row : rows) {
     ofs << repo_name << ','
         << model_name << ','
@@ -96,7 +116,18 @@ void WriteStageCyclesCsv(const std::string& repo_name,
         << LayerKindToString(row.kind) << ','
         << row.cycles.load_cycles << ','
         << row.cycles.compute_cycles << ','
-        << row.cycles.store_cycles << '\n';
+        << row.cycles.store_cycles << ','
+        << row.cycles.weight_reloads << ','
+        << row.cycles.weight_reload_bytes << ','
+        << row.weight_bytes_saved << ','
+        << row.cycles.weight_hits << ','
+        << row.cycles.weight_evicted_bytes << ','
+        << row.cycles.tob_stall_cycles << ','
+        << row.cycles.sort_cycles << ','
+        << row.cycles.dram_row_hits << ','
+        << row.cycles.dram_row_misses << ','
+        << row.cycles.invalid_taps << ','
+        << row.cycles.weight_prefetches << '\n';
   }
   ofs.flush();
   std::cout << "[Simulation] Stage cycles CSV written to " << csv_path << "\n";
@@ -113,7 +144,8 @@ void WriteSramAccessCsv(const std::string& repo_name,
   }
 
   ofs << "model,layer_id,layer_name,layer_kind,"
-         "isb_accesses,filter_accesses,output_accesses,total_cycles\n";
+         "isb_accesses,filter_accesses,output_accesses,total_cycles,"
+         "isb_dram_bytes_avoided\n";
   for (const auto& row : rows) {
     const std::uint64_t total_cycles =
         row.cycles.load_cycles + row.cycles.compute_cycles + row.cycles.store_cycles;
@@ -124,7 +156,8 @@ void WriteSramAccessCsv(const std::string& repo_name,
         << row.sram_stats.input_spine.accesses << ','
         << row.sram_stats.filter.accesses << ','
         << row.sram_stats.output_queue.accesses << ','
-        << total_cycles << '\n';
+        << total_cycles << ','
+        << row.sram_stats.input_spine_dram_bytes_avoided << '\n';
   }
   ofs.flush();
   std::cout << "[Simulation] SRAM access CSV written to " << csv_path << "\n";
@@ -141,7 +174,9 @@ void WriteSramCapacityCsv(const std::string& repo_name,
   }
 
   ofs << "model,layer_id,layer_name,layer_kind,"
-         "isb_capacity_bytes,filter_capacity_bytes,output_queue_capacity_bytes\n";
+         "isb_capacity_bytes,filter_capacity_bytes,output_queue_capacity_bytes,"
+         "isb_shadow_capacity_bytes,tob_merge_comparators,tob_merge_depth,"
+         "sorter_merge_comparators,sorter_merge_depth,tob_shadow_capacity_bytes\n";
 
   for (const auto& row : rows) {
     ofs << model_name << ','
@@ -150,12 +185,64 @@ void WriteSramCapacityCsv(const std::string& repo_name,
         << LayerKindToString(row.kind) << ','
         << row.sram_stats.input_spine_capacity_bytes << ','
         << row.sram_stats.filter_capacity_bytes << ','
-        << row.sram_stats.output_queue_capacity_bytes << '\n';
+        << row.sram_stats.output_queue_capacity_bytes << ','
+        << row.sram_stats.input_spine_shadow_capacity_bytes << ','
+        << row.sram_stats.tob_merge.comparators << ','
+        << row.sram_stats.tob_merge.depth << ','
+        << row.sram_stats.sorter_merge.comparators << ','
+        << row.sram_stats.sorter_merge.depth << ','
+        << row.sram_stats.output_queue_shadow_capacity_bytes << '\n';
   }
   ofs.flush();
   std::cout << "[Simulation] SRAM capacity CSV written to " << csv_path << "\n";
 }
 
+// One row per (layer, core); layers that ran on a single core report it as core 0.
+void WriteChipCsv(const std::string& repo_name,
+                  const std::string& model_name,
+                  const std::vector<LayerStageRecord>& rows) {
+  const auto csv_path = BuildChipCsvPath(repo_name, model_name);
+  std::filesystem::create_directories(csv_path.parent_path());
+  std::ofstream ofs(csv_path, std::ios::out | std::ios::trunc);
+  if (!ofs) {
+    throw std::runtime_error("RunNetwork: failed to open chip cores CSV file " + csv_path.string());
+  }
+
+  ofs << "model,layer_id,layer_name,layer_kind,core,sites,busy_cycles,compute_cycles,"
+         "dram_bytes,dram_stall_cycles,makespan,utilisation,dram_port_utilisation\n";
+  for (const auto& row : rows) {
+    ChipStats chip = row.chip;
+    if (chip.cores.empty()) {
+      ChipCoreStats single;
+      single.sites = 1;
+      single.cycles = row.cycles;
+      single.busy_cycles =
+          row.cycles.load_cycles + row.cycles.compute_cycles + row.cycles.store_cycles;
+      chip.cores.push_back(single);
+      chip.makespan = single.busy_cycles;
+    }
+    const double makespan = static_cast<double>(chip.makespan);
+    for (std::size_t c = 0; c < chip.cores.size(); ++c) {
+      const ChipCoreStats& core = chip.cores[c];
+      ofs << model_name << ','
+          << row.layer_id << ','
+          << std::quoted(row.layer_name) << ','
+          << LayerKindToString(row.kind) << ','
+          << c << ','
+          << core.sites << ','
+          << core.busy_cycles << ','
+          << core.cycles.compute_cycles << ','
+          << core.dram_bytes << ','
+          << core.dram_stall_cycles << ','
+          << chip.makespan << ','
+          << (makespan > 0 ? static_cast<double>(core.cycles.compute_cycles) / makespan : 0.0) << ','
+          << (makespan > 0 ? static_cast<double>(chip.dram_busy_cycles) / makespan : 0.0) << '\n';
+    }
+  }
+  ofs.flush();
+  std::cout << "[Simulation] Chip cores CSV written to " << csv_path << "\n";
+}
+
 } // namespace
 
 static LayerKind ParseKind_(const std::string& s) {
@@ -165,6 +252,10 @@ static LayerKind ParseKind_(const std::string& s) {
 }
 
 std::vector<LayerSpec> ParseConfig(const std::string& json_path) {
+  if (IsMetaIndexFile(json_path)) {
+    return ParseMetaIndex(json_path);
+  }
+
   // Read entire JSON file as text.
   std::ifstream ifs(json_path);
   if (!ifs) throw std::runtime_error("ParseConfig: cannot open json file: " + json_path);
@@ -284,49 +375,27 @@ std::vector<LayerSpec> ParseConfig(const std::string& json_path) {
   return out;
 }
 
-sf::dram::SimpleDRAM InitDram(const std::string& bin_path, const std::string& json_path) {
+sf::dram::SimpleDRAM InitDram(const std::string& bin_path, const std::string& json_path,
+                              sf::dram::SimpleDRAM::Storage storage) {
+  if (IsMetaIndexFile(json_path)) {
+    auto dram = sf::dram::SimpleDRAM::FromImage(bin_path, storage);
+    BuildDramFromMetaIndex(json_path, dram);
+    return dram;
+  }
   // Delegate to the convenience factory; it also builds per-layer tables.
-  return sf::dram::SimpleDRAM::FromFiles(bin_path, json_path);
+  return sf::dram::SimpleDRAM::FromFiles(bin_path, json_path, storage);
 }
 
-void RunNetwork(const std::vector<LayerSpec>& specs,
-                sf::dram::SimpleDRAM* dram,
-                const std::string& repo_name,
-                const std::string& model_name) {
-  if (!dram) throw std::invalid_argument("RunNetwork: null DRAM pointer");
+namespace {
 
-  std::vector<LayerStageRecord> stage_rows;
-  stage_rows.reserve(specs.size());
-
-  for (const auto& s : specs) {
-    switch (s.kind) {
-      case LayerKind::kConv: {
-        ConvLayer conv;
-        conv.ConfigureLayer(s.L,
-                            s.Cin_in, s.Cout,
-                            s.H_in,   s.W_in,
-                            s.Kh,     s.Kw,
-                            s.Sh,     s.Sw,
-                            s.Ph,     s.Pw,
-                            s.threshold_,
-                            s.w_bits,
-                            s.w_signed,
-                            s.w_frac_bits,
-                            s.w_scale,
-                            dram);
-        conv.run_layer();
-        stage_rows.push_back(LayerStageRecord{
-            s.L,
-            s.name,
-            s.kind,
-            conv.cycle_stats(),
-            conv.sram_stats()
-        });
-        break;
-      }
-      case LayerKind::kFC: {
-        FCLayer fc;
-        fc.ConfigureLayer(s.L,
+// Configure and run one layer on its own engines.
+LayerStageRecord RunLayer(const LayerSpec& s,
+                          sf::dram::SimpleDRAM* dram,
+                          const SimOptions& options) {
+  switch (s.kind) {
+    case LayerKind::kConv: {
+      ConvLayer conv;
+      conv.ConfigureLayer(s.L,
                           s.Cin_in, s.Cout,
                           s.H_in,   s.W_in,
                           s.Kh,     s.Kw,
@@ -338,24 +407,111 @@ void RunNetwork(const std::vector<LayerSpec>& specs,
                           s.w_frac_bits,
                           s.w_scale,
                           dram);
-        fc.run_layer();
-        stage_rows.push_back(LayerStageRecord{
-            s.L,
-            s.name,
-            s.kind,
-            fc.cycle_stats(),
-            fc.sram_stats()
-        });
-        break;
+      conv.SetNumThreads(options.site_threads);
+      conv.SetCoreOptions(options.core);
+      conv.SetDataflow(options.conv_dataflow);
+      conv.SetTileOrder(options.tile_order);
+      conv.SetChip(options.chip);
+      conv.run_layer();
+      return LayerStageRecord{
+          s.L,
+          s.name,
+          s.kind,
+          conv.cycle_stats(),
+          conv.sram_stats(),
+          conv.drained_entries_total(),
+          conv.weight_bytes_saved(),
+          conv.chip_stats()
+      };
+    }
+    case LayerKind::kFC: {
+      FCLayer fc;
+      fc.ConfigureLayer(s.L,
+                        s.Cin_in, s.Cout,
+                        s.H_in,   s.W_in,
+                        s.Kh,     s.Kw,
+                        s.Sh,     s.Sw,
+                        s.Ph,     s.Pw,
+                        s.threshold_,
+                        s.w_bits,
+                        s.w_signed,
+                        s.w_frac_bits,
+                        s.w_scale,
+                        dram);
+      fc.SetCoreOptions(options.core);
+      fc.run_layer();
+      return LayerStageRecord{
+          s.L,
+          s.name,
+          s.kind,
+          fc.cycle_stats(),
+          fc.sram_stats(),
+          fc.drained_entries_total()
+      };
+    }
+    default:
+      throw std::runtime_error("RunNetwork: unsupported layer kind at L=" + std::to_string(s.L));
+  }
+}
+
+} // namespace
+
+void RunNetwork(const std::vector<LayerSpec>& specs,
+                sf::dram::SimpleDRAM* dram,
+                const std::string& repo_name,
+                const std::string& model_name,
+                const SimOptions& options) {
+  if (!dram) throw std::invalid_argument("RunNetwork: null DRAM pointer");
+  if (options.layer_threads <= 0) {
+    throw std::invalid_argument("RunNetwork: layer_threads must be positive");
+  }
+
+  // One slot per spec so rows come out in L order whatever finishes first.
+  std::vector<LayerStageRecord> stage_rows(specs.size());
+
+  const std::size_t workers =
+      std::min<std::size_t>(static_cast<std::size_t>(options.layer_threads), specs.size());
+  if (workers <= 1) {
+    for (std::size_t i = 0; i < specs.size(); ++i) {
+      stage_rows[i] = RunLayer(specs[i], dram, options);
+    }
+  } else {
+    // Output regions are partitioned per layer; refuse to share one.
+    dram->CheckOutputRegionsDisjoint();
+
+    std::atomic<std::size_t> next{0};
+    std::vector<std::exception_ptr> errors(specs.size());
+    auto worker = [&]() {
+      for (std::size_t i = next++; i < specs.size(); i = next++) {
+        try {
+          stage_rows[i] = RunLayer(specs[i], dram, options);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
       }
-      default:
-        throw std::runtime_error("RunNetwork: unsupported layer kind at L=" + std::to_string(s.L));
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t t = 1; t < workers; ++t) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+    for (const auto& e : errors) {
+      if (e) std::rethrow_exception(e);
+    }
+  }
+
+  for (const auto& row : stage_rows) {
+    if (row.kind == LayerKind::kConv) {
+      std::cout << "drained entries: " << row.drained_entries << "\n";
     }
   }
 
   WriteStageCyclesCsv(repo_name, model_name, stage_rows);
   WriteSramAccessCsv(repo_name, model_name, stage_rows);
   WriteSramCapacityCsv(repo_name, model_name, stage_rows);
+  if (options.chip.cores > 1) {
+    WriteChipCsv(repo_name, model_name, stage_rows);
+  }
 }
 
 } // namespace sf
@@ -0,0 +1,114 @@
+// All comments are in English.
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "arch/dram/simple_dram.hpp"
+
+// Microbenchmark for SimpleDRAM::LoadInputSpine lookup cost.
+//
+// Builds an in-memory DRAM with a VGG-like set of layers, then performs the
+// same pseudo-random sequence of spine loads through:
+//   (a) SimpleDRAM (IdTable: dense vector per layer and per spine table);
+//   (b) the previous layout: unordered_map<L, unordered_map<spine_id, meta>>
+//       with the same bounds check and memcpy.
+// Reports ns per load for a small payload (lookup-dominated) and for a full
+// ISB buffer payload.
+
+namespace {
+
+using sf::dram::LayerMeta;
+using sf::dram::SimpleDRAM;
+using sf::dram::SpineMeta;
+
+struct LegacyTables {
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, SpineMeta>> layers;
+  const std::vector<uint8_t>* mem = nullptr;
+
+  uint32_t LoadInputSpine(uint32_t L, uint32_t spine_id, void* dst, uint32_t max_bytes) const {
+    auto itL = layers.find(L);
+    if (itL == layers.end()) throw std::out_of_range("layer not found");
+    auto it = itL->second.find(spine_id);
+    if (it == itL->second.end()) throw std::out_of_range("input spine not found");
+    const SpineMeta& m = it->second;
+    const uint32_t n = (m.size <= max_bytes) ? m.size : max_bytes;
+    if (m.addr + n > mem->size()) throw std::out_of_range("read out of range");
+    std::memcpy(dst, mem->data() + m.addr, n);
+    return n;
+  }
+};
+
+struct Request {
+  uint32_t L;
+  uint32_t spine_id;
+};
+
+template <typename Fn>
+double NsPerLoad(const std::vector<Request>& reqs, int reps, Fn&& load) {
+  uint64_t sink = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    for (const Request& q : reqs) sink += load(q);
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  if (sink == 42) std::cout << "";  // keep the loop observable
+  const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  return ns / (static_cast<double>(reqs.size()) * reps);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int reps = (argc > 1) ? std::atoi(argv[1]) : 20;
+
+  // Layer shapes: spines per layer (H*W), as in a 32x32-input VGG.
+  const std::vector<uint32_t> spines_per_layer = {1024, 1024, 256, 256, 64, 64, 64, 16, 16, 16, 4, 4, 4};
+  constexpr uint32_t kSpineBytes = 2048 * 8;  // one full ISB buffer
+
+  uint64_t total_bytes = 0;
+  for (uint32_t n : spines_per_layer) total_bytes += uint64_t{n} * kSpineBytes;
+
+  SimpleDRAM dram(total_bytes);
+  std::vector<uint8_t> legacy_mem(static_cast<size_t>(total_bytes), 0);
+  LegacyTables legacy;
+  legacy.mem = &legacy_mem;
+
+  std::vector<Request> reqs;
+  uint64_t addr = 0;
+  for (uint32_t L = 0; L < spines_per_layer.size(); ++L) {
+    LayerMeta meta;
+    for (uint32_t id = 0; id < spines_per_layer[L]; ++id) {
+      const SpineMeta sm{id, addr, kSpineBytes};
+      meta.input_spines.Insert(id, sm);
+      legacy.layers[L][id] = sm;
+      addr += kSpineBytes;
+      reqs.push_back({L, id});
+    }
+    dram.SetLayerMeta(L, std::move(meta));
+  }
+
+  // Deterministic shuffle so neither layout benefits from sequential ids.
+  uint64_t x = 0x9E3779B97F4A7C15ull;
+  for (size_t i = reqs.size(); i > 1; --i) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    std::swap(reqs[i - 1], reqs[static_cast<size_t>(x % i)]);
+  }
+
+  std::vector<uint8_t> dst(kSpineBytes);
+  for (uint32_t payload : {8u, kSpineBytes}) {
+    const double dense = NsPerLoad(reqs, reps, [&](const Request& q) {
+      return dram.LoadInputSpine(q.L, q.spine_id, dst.data(), payload);
+    });
+    const double maps = NsPerLoad(reqs, reps, [&](const Request& q) {
+      return legacy.LoadInputSpine(q.L, q.spine_id, dst.data(), payload);
+    });
+    std::cout << "payload " << payload << " B: dense " << dense << " ns/load, "
+              << "hash maps " << maps << " ns/load, speedup " << (maps / dense) << "x\n";
+  }
+  return 0;
+}
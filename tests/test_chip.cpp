@@ -0,0 +1,214 @@
+// All comments are in English.
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "arch/dram/dram_timing.hpp"
+#include "core/chip.hpp"
+#include "model/conv_layer.hpp"
+#include "runner/simulation.hpp"
+
+static int g_failures = 0;
+
+static void check_eq(const std::string& what, std::uint64_t got, std::uint64_t expected) {
+  if (got != expected) {
+    ++g_failures;
+    std::cout << "[FAIL] " << what << ": got " << got << ", expected " << expected << "\n";
+  }
+}
+
+static void check_sites(const std::string& what, const std::vector<int>& got,
+                        const std::vector<int>& expected) {
+  if (got != expected) {
+    ++g_failures;
+    std::cout << "[FAIL] " << what << ": got";
+    for (int c : got) std::cout << " " << c;
+    std::cout << ", expected";
+    for (int c : expected) std::cout << " " << c;
+    std::cout << "\n";
+  }
+}
+
+static std::vector<int> partition(const sf::SitePartitionPolicy& policy, int cores,
+                                  int H_out, int W_out,
+                                  const std::vector<std::uint64_t>& site_work = {}) {
+  std::vector<int> core_of_site;
+  policy(cores, H_out, W_out, site_work, core_of_site);
+  return core_of_site;
+}
+
+static void test_round_robin() {
+  check_sites("round-robin 3 cores 2x4", partition(sf::RoundRobinSites(), 3, 2, 4),
+              {0, 1, 2, 0, 1, 2, 0, 1});
+}
+
+static void test_spike_balanced() {
+  // Heaviest first (5, 4, 3, 2, 1 at sites 0, 2, 4, 3, 1) onto the least
+  // loaded core, each site costing work + 1:
+  //   s0 -> c0 (6), s2 -> c1 (5), s4 -> c1 (9), s3 -> c0 (9), s1 -> c0 (tie).
+  check_sites("spike-balanced 2 cores", partition(sf::SpikeBalancedSites(), 2, 1, 5, {5, 1, 4, 2, 3}),
+              {0, 0, 1, 0, 1});
+  // No work known: every site costs 1, so sites alternate in site order.
+  check_sites("spike-balanced no work", partition(sf::SpikeBalancedSites(), 2, 2, 2),
+              {0, 1, 0, 1});
+}
+
+static void test_spatial_grid() {
+  // rows = the largest divisor d of cores with d * d <= cores, cols =
+  // cores / rows; the longer axis gets the larger count.
+  // 6 cores: 2 x 3 on a wide plane, 3 x 2 on a tall one.
+  check_sites("spatial 6 cores 2x3", partition(sf::SpatialBlockSites(), 6, 2, 3),
+              {0, 1, 2,
+               3, 4, 5});
+  check_sites("spatial 6 cores 3x2", partition(sf::SpatialBlockSites(), 6, 3, 2),
+              {0, 1,
+               2, 3,
+               4, 5});
+  // 4 cores: 2 x 2 blocks of 2 x 2 sites.
+  check_sites("spatial 4 cores 4x4", partition(sf::SpatialBlockSites(), 4, 4, 4),
+              {0, 0, 1, 1,
+               0, 0, 1, 1,
+               2, 2, 3, 3,
+               2, 2, 3, 3});
+  // Prime core count: 1 x 3 strips across the longer axis.
+  check_sites("spatial 3 cores 2x6", partition(sf::SpatialBlockSites(), 3, 2, 6),
+              {0, 0, 1, 1, 2, 2,
+               0, 0, 1, 1, 2, 2});
+  check_sites("spatial 3 cores 6x2", partition(sf::SpatialBlockSites(), 3, 6, 2),
+              {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2});
+  // 8 cores on 3 x 5: 2 x 4 grid, bands h * 2 / 3 and w * 4 / 5.
+  check_sites("spatial 8 cores 3x5", partition(sf::SpatialBlockSites(), 8, 3, 5),
+              {0, 0, 1, 2, 3,
+               0, 0, 1, 2, 3,
+               4, 4, 5, 6, 7});
+}
+
+static sf::DramTransfer transfer(std::uint64_t issue, std::uint64_t ready, std::uint64_t bytes) {
+  sf::DramTransfer x;
+  x.issue = issue;
+  x.ready = ready;
+  x.bytes = bytes;
+  x.ranges = {{0, bytes}};
+  return x;
+}
+
+static void test_replay_fcfs() {
+  // 10 B/cycle, so 100 B = 10 cycles and 50 B = 5 cycles.
+  //   core 0: A issue 0 ready 5 (100 B), B issue 20 ready 25 (50 B)
+  //   core 1: C issue 0 ready 12 (100 B), D issue 15 no deadline (100 B)
+  // A 0..10 (late by 5: core 0 delay 5), C 10..20 (late by 8: core 1 delay
+  // 8). D is shifted to 15 + 8 = 23 and B to 20 + 5 = 25, so D goes first,
+  // 23..33. B runs 33..38 against its shifted deadline 30: core 0 delay 13.
+  const sf::dram::FlatDramTiming port(10.0);
+  std::vector<std::vector<sf::DramTransfer>> traces(2);
+  traces[0] = {transfer(20, 25, 50), transfer(0, 5, 100)};  // sorted by issue in the replay
+  traces[1] = {transfer(0, 12, 100), transfer(15, sf::DramTransfer::kNoDeadline, 100)};
+  std::uint64_t busy = 0;
+  const auto delay = sf::Chip::ReplayDram(traces, port, &busy);
+  check_eq("replay delay core 0", delay[0], 13);
+  check_eq("replay delay core 1", delay[1], 8);
+  check_eq("replay port busy", busy, 35);
+
+  // Core 0 alone: A 0..10 (delay 5), B 25..30 meets its deadline 30.
+  const auto alone = sf::Chip::ReplayDram({traces[0]}, port, nullptr);
+  check_eq("replay alone core 0", alone[0], 5);
+
+  // Same issue cycle: the lower core goes first.
+  std::vector<std::vector<sf::DramTransfer>> tie(2);
+  tie[0] = {transfer(0, 10, 100)};
+  tie[1] = {transfer(0, 10, 100)};
+  const auto tie_delay = sf::Chip::ReplayDram(tie, port, nullptr);
+  check_eq("replay tie core 0", tie_delay[0], 0);
+  check_eq("replay tie core 1", tie_delay[1], 10);
+}
+
+// Every site on core 0 of a 2-core chip: core 0 runs the layer alone on the
+// shared port, so it must reproduce the single-core cycle counts and never
+// stall on DRAM.
+static void test_one_core_workload(const std::string& bin_path, const std::string& json_path,
+                                   int max_layers) {
+  const auto specs = sf::ParseConfig(json_path);
+  auto dram = sf::InitDram(bin_path, json_path);
+  sf::ChipOptions chip;
+  chip.cores = 2;
+  chip.partition = [](int, int H_out, int W_out, const std::vector<std::uint64_t>&,
+                      std::vector<int>& core_of_site) {
+    core_of_site.assign(static_cast<std::size_t>(H_out) * static_cast<std::size_t>(W_out), 0);
+  };
+
+  int layers = 0;
+  for (const auto& s : specs) {
+    if (s.kind != sf::LayerKind::kConv) continue;
+    if (max_layers >= 0 && layers >= max_layers) break;
+    ++layers;
+
+    sf::CoreCycleStats single{};
+    sf::ChipStats multi{};
+    sf::CoreCycleStats multi_cycles{};
+    for (int run = 0; run < 2; ++run) {
+      sf::ConvLayer conv;
+      conv.ConfigureLayer(s.L, s.Cin_in, s.Cout, s.H_in, s.W_in, s.Kh, s.Kw, s.Sh, s.Sw,
+                          s.Ph, s.Pw, s.threshold_, s.w_bits, s.w_signed, s.w_frac_bits,
+                          s.w_scale, &dram);
+      if (run == 1) conv.SetChip(chip);
+      conv.run_layer();
+      if (run == 0) {
+        single = conv.cycle_stats();
+      } else {
+        multi = conv.chip_stats();
+        multi_cycles = conv.cycle_stats();
+      }
+    }
+    const std::string tag = "L=" + std::to_string(s.L) + " ";
+    check_eq(tag + "load_cycles", multi_cycles.load_cycles, single.load_cycles);
+    check_eq(tag + "compute_cycles", multi_cycles.compute_cycles, single.compute_cycles);
+    check_eq(tag + "store_cycles", multi_cycles.store_cycles, single.store_cycles);
+    check_eq(tag + "weight_reload_bytes", multi_cycles.weight_reload_bytes, single.weight_reload_bytes);
+    check_eq(tag + "core 0 dram stall", multi.cores.at(0).dram_stall_cycles, 0);
+    check_eq(tag + "makespan", multi.makespan,
+             single.load_cycles + single.compute_cycles + single.store_cycles);
+  }
+  std::cout << "One-core chip checked on " << layers << " conv layer(s).\n";
+}
+
+static void print_usage(const char* argv0) {
+  std::cerr
+      << "Usage:\n"
+      << "  " << argv0 << " [<image.bin> <meta.json> [max_layers]]\n\n"
+      << "Description:\n"
+      << "  Checks the site partitions and the shared-port DRAM replay of Chip\n"
+      << "  against hand-computed results. With a workload, also checks that a\n"
+      << "  chip running every site on one core reproduces the single-core\n"
+      << "  cycle counts of the first max_layers conv layers (default: all).\n"
+      << "  Exit code 0 = all passed, 1 = a check failed, 2 = error.\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc == 2 || argc > 4) {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  try {
+    test_round_robin();
+    test_spike_balanced();
+    test_spatial_grid();
+    test_replay_fcfs();
+    if (argc >= 3) {
+      test_one_core_workload(argv[1], argv[2], argc > 3 ? std::atoi(argv[3]) : -1);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << "\n";
+    return 2;
+  }
+
+  if (g_failures != 0) {
+    std::cout << g_failures << " check(s) failed.\n";
+    return 1;
+  }
+  std::cout << "All chip checks passed.\n";
+  return 0;
+}
@@ -0,0 +1,146 @@
+// All comments are in English.
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "arch/dram/dram_timing.hpp"
+#include "core/chip.hpp"
+
+using sf::dram::BankedDramConfig;
+using sf::dram::BankedDramTiming;
+using sf::dram::DramRange;
+using sf::dram::FlatDramTiming;
+
+static int g_failures = 0;
+
+static void check_eq(const std::string& what, std::uint64_t got, std::uint64_t expected) {
+  if (got != expected) {
+    ++g_failures;
+    std::cout << "[FAIL] " << what << ": got " << got << ", expected " << expected << "\n";
+  }
+}
+
+static void check_stats(const std::string& what, const sf::dram::DramTiming& t,
+                        std::uint64_t hits, std::uint64_t misses, std::uint64_t bursts) {
+  check_eq(what + " row_hits", t.stats().row_hits, hits);
+  check_eq(what + " row_misses", t.stats().row_misses, misses);
+  check_eq(what + " bursts", t.stats().bursts, bursts);
+}
+
+// 2 channels x 2 banks, rows of 2 bursts (128 B), 64 B bursts at 32 B/cycle
+// (2 cycles each). A stripe is one row in every channel: 4 bursts = 256 B.
+//   burst b -> channel b % 2, stripe b / 4, bank stripe % 2, row stripe / 2.
+static BankedDramConfig small_config() {
+  BankedDramConfig c;
+  c.channels = 2;
+  c.banks = 2;
+  c.row_bytes = 128;
+  c.burst_bytes = 64;
+  c.channel_bytes_per_cycle = 32.0;
+  c.row_hit_cycles = 10;
+  c.row_miss_cycles = 20;
+  c.transaction_overhead_cycles = 5;
+  return c;
+}
+
+static void test_flat() {
+  FlatDramTiming flat(160.0);
+  check_eq("flat 1000 B", flat.Cycles({{0, 1000}}, false), 7);      // ceil(1000 / 160)
+  check_eq("flat 2 x 80 B", flat.Cycles({{0, 80}, {4096, 80}}, true), 1);
+  check_eq("flat empty", flat.Cycles({{0, 0}}, false), 0);
+  check_eq("flat transactions", flat.stats().transactions, 2);
+  FlatDramTiming slow(10.0, 3);
+  check_eq("flat overhead", slow.Cycles({{0, 95}}, false), 13);     // 10 + 3
+}
+
+static void test_banked_mapping() {
+  BankedDramTiming t(small_config());
+
+  // Stripe 0: bursts 0, 2 on channel 0 and 1, 3 on channel 1, all bank 0
+  // row 0. Each channel opens the row (20) then streams 2 bursts (4):
+  // 5 + 10 + 24.
+  check_eq("first stripe", t.Cycles({{0, 256}}, false), 39);
+  check_stats("first stripe", t, 2, 2, 4);
+
+  // Same stripe again: every row is open, 5 + 10 + 4.
+  check_eq("open rows", t.Cycles({{0, 256}}, false), 19);
+  check_stats("open rows", t, 6, 2, 8);
+
+  // Burst 8: stripe 2 -> bank 0, row 1, channel 0. Row 0 is open there:
+  // 5 + 10 + 20 + 2.
+  check_eq("row conflict", t.Cycles({{512, 64}}, false), 37);
+  check_stats("row conflict", t, 6, 3, 9);
+
+  // Burst 4: stripe 1 -> bank 1, row 0, channel 0; a closed bank misses too.
+  check_eq("other bank", t.Cycles({{256, 64}}, false), 37);
+  check_stats("other bank", t, 6, 4, 10);
+
+  // Reset closes every row and clears the counters.
+  t.Reset();
+  check_stats("reset", t, 0, 0, 0);
+  check_eq("reset misses", t.Cycles({{0, 64}}, false), 37);
+}
+
+static void test_banked_overlap() {
+  // Bank 0 and bank 1 of channel 0 both miss in one transaction. The second
+  // activation overlaps the first one's data: channel 0 is busy 20..22, then
+  // 22..24 (not 42..44), so 5 + 10 + 24.
+  BankedDramTiming t(small_config());
+  check_eq("bank overlap", t.Cycles({{0, 64}, {256, 64}}, false), 39);
+  check_stats("bank overlap", t, 0, 2, 2);
+
+  // Bursts 3 and 4 straddle a stripe: burst 3 -> channel 1, bank 0; burst 4
+  // -> channel 0, bank 1. Two channels in parallel: 5 + 10 + 22.
+  t.Reset();
+  check_eq("stripe straddle", t.Cycles({{192, 128}}, false), 37);
+  check_stats("stripe straddle", t, 0, 2, 2);
+
+  // Bursts 0, 2 (bank 0) then 4, 6 (bank 1), all on channel 0, one range
+  // each: a miss and a hit per bank. Channel 0 is busy 20..24 for bank 0 and
+  // 24..28 for bank 1 (its activation overlapped): 5 + 10 + 28.
+  t.Reset();
+  check_eq("strided", t.Cycles({{0, 64}, {128, 64}, {256, 64}, {384, 64}}, false), 43);
+  check_stats("strided", t, 2, 2, 4);
+}
+
+static void test_shared_port_rows() {
+  // Two cores alternate rows of bank 0 / channel 0 on one banked port. The
+  // port keeps one set of open rows, so core 1's access closes core 0's row
+  // and every transfer misses: 3 x 37 busy cycles. On separate models core
+  // 0's second access would hit (19 - 2 = 17 cycles).
+  std::vector<std::vector<sf::DramTransfer>> traces(2);
+  auto transfer = [](std::uint64_t issue, std::uint64_t addr) {
+    sf::DramTransfer x;
+    x.issue = issue;
+    x.bytes = 64;
+    x.ranges = {{addr, 64}};
+    return x;
+  };
+  traces[0] = {transfer(0, 0), transfer(100, 0)};
+  traces[1] = {transfer(50, 512)};
+  const BankedDramTiming port(small_config());
+  std::uint64_t busy = 0;
+  const auto delay = sf::Chip::ReplayDram(traces, port, &busy);
+  check_eq("shared port busy", busy, 3 * 37);
+  check_eq("shared port stall core 0", delay[0], 0);
+  check_eq("shared port stall core 1", delay[1], 0);
+
+  // Alone, core 0 re-opens nothing: 37 + 17.
+  std::uint64_t alone = 0;
+  sf::Chip::ReplayDram({traces[0]}, port, &alone);
+  check_eq("core 0 alone busy", alone, 37 + 17);
+}
+
+int main() {
+  test_flat();
+  test_banked_mapping();
+  test_banked_overlap();
+  test_shared_port_rows();
+  if (g_failures != 0) {
+    std::cout << g_failures << " check(s) failed.\n";
+    return 1;
+  }
+  std::cout << "All DRAM timing checks passed.\n";
+  return 0;
+}
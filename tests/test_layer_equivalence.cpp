@@ -0,0 +1,132 @@
+// All comments are in English.
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "model/conv_layer.hpp"
+#include "runner/simulation.hpp"
+
+// One configuration whose drained entries must match the default run.
+struct Variant {
+  std::string name;
+  sf::SimOptions options;
+};
+
+static std::vector<Variant> make_variants() {
+  std::vector<Variant> v;
+  v.push_back({"default", {}});
+  // Wide input integrates in chained stages, so spikes match width 1.
+  for (std::size_t width : {2u, 4u, 8u}) {
+    sf::SimOptions o;
+    o.core.input_width = width;
+    v.push_back({"input_width=" + std::to_string(width), o});
+  }
+  // Weight replacement only changes weight traffic.
+  for (auto [name, policy] : {std::pair{"belady", sf::WeightCachePolicy::kBelady},
+                              std::pair{"pingpong", sf::WeightCachePolicy::kPingPong}}) {
+    sf::SimOptions o;
+    o.core.weight_cache = policy;
+    v.push_back({std::string("weight_cache=") + name, o});
+  }
+  // Every chip partition runs each site exactly once.
+  for (auto [name, partition] : {std::pair{"round-robin", sf::RoundRobinSites()},
+                                 std::pair{"spike-balanced", sf::SpikeBalancedSites()},
+                                 std::pair{"spatial", sf::SpatialBlockSites()}}) {
+    for (int cores : {3, 4}) {
+      sf::SimOptions o;
+      o.chip.cores = cores;
+      o.chip.partition = partition;
+      v.push_back({"cores=" + std::to_string(cores) + " " + name, o});
+    }
+  }
+  return v;
+}
+
+// Configure one conv layer (as RunNetwork does), run it twice and return
+// the drained entries of both runs (a rerun must repeat the first).
+static std::pair<int, int> run_conv(const sf::LayerSpec& s, sf::dram::SimpleDRAM* dram,
+                                    const sf::SimOptions& options) {
+  sf::ConvLayer conv;
+  conv.ConfigureLayer(s.L,
+                      s.Cin_in, s.Cout,
+                      s.H_in,   s.W_in,
+                      s.Kh,     s.Kw,
+                      s.Sh,     s.Sw,
+                      s.Ph,     s.Pw,
+                      s.threshold_,
+                      s.w_bits,
+                      s.w_signed,
+                      s.w_frac_bits,
+                      s.w_scale,
+                      dram);
+  conv.SetNumThreads(options.site_threads);
+  conv.SetCoreOptions(options.core);
+  conv.SetDataflow(options.conv_dataflow);
+  conv.SetTileOrder(options.tile_order);
+  conv.SetChip(options.chip);
+  conv.run_layer();
+  const int first = conv.drained_entries_total();
+  conv.run_layer();
+  return {first, conv.drained_entries_total()};
+}
+
+static void print_usage(const char* argv0) {
+  std::cerr
+      << "Usage:\n"
+      << "  " << argv0 << " <image.bin> <meta.json> [max_layers]\n\n"
+      << "Description:\n"
+      << "  Runs the first max_layers conv layers (default: all) twice per\n"
+      << "  variant (input widths, weight caches, chip partitions) and checks\n"
+      << "  that every run drains exactly as many entries as the default.\n"
+      << "  Exit code 0 = all equal, 1 = mismatch, 2 = error.\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  const std::string bin_path  = argv[1];
+  const std::string json_path = argv[2];
+  const int max_layers = argc > 3 ? std::atoi(argv[3]) : -1;
+
+  try {
+    const auto specs = sf::ParseConfig(json_path);
+    auto dram = sf::InitDram(bin_path, json_path);
+    const auto variants = make_variants();
+
+    int layers = 0;
+    int mismatches = 0;
+    for (const auto& s : specs) {
+      if (s.kind != sf::LayerKind::kConv) continue;
+      if (max_layers >= 0 && layers >= max_layers) break;
+      ++layers;
+
+      int expected = 0;
+      for (std::size_t i = 0; i < variants.size(); ++i) {
+        const auto [first, rerun] = run_conv(s, &dram, variants[i].options);
+        if (i == 0) {
+          expected = first;
+          std::cout << "L=" << s.L << " " << s.name << ": drained=" << expected << "\n";
+        }
+        if (first != expected || rerun != expected) {
+          ++mismatches;
+          std::cout << "  [MISMATCH] " << variants[i].name << ": drained=" << first
+                    << ", rerun=" << rerun << "\n";
+        }
+      }
+    }
+
+    std::cout << "===== Summary =====\n";
+    std::cout << "Conv layers: " << layers << ", variants: " << variants.size()
+              << ", mismatches: " << mismatches << "\n";
+    return mismatches == 0 ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << "[ERROR] " << e.what() << "\n";
+    return 2;
+  }
+}
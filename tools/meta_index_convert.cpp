@@ -0,0 +1,30 @@
+// All comments are in English.
+#include <iostream>
+#include <string>
+
+#include "runner/meta_index.hpp"
+
+static void print_usage(const char* argv0) {
+  std::cerr
+      << "Usage:\n"
+      << "  " << argv0 << " <dram_meta.json> <out.sfmi>\n\n"
+      << "Description:\n"
+      << "  Converts layer parameters and DRAM tables from <dram_meta.json> into the\n"
+      << "  binary metadata index. spinalflow-sim accepts the index in place of the\n"
+      << "  JSON (detected by its magic header).\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  try {
+    sf::WriteMetaIndex(argv[1], argv[2]);
+    std::cout << "[MetaIndex] Wrote " << argv[2] << "\n";
+    return 0;
+  } catch (const std::exception& ex) {
+    std::cerr << "[MetaIndex] Error: " << ex.what() << "\n";
+    return 2;
+  }
+}